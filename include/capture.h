@@ -0,0 +1,55 @@
+/**
+ *
+ * GPS capture format
+ * Tauno Erik
+ *
+ * A capture is the raw input of the clock: the bytes from the GPS module
+ * in the chunks they arrived in, and the PPS pulses, each with the
+ * micros() of its arrival. It is written by the recorder and read back by
+ * the replay tool (tools/replay), which feeds it to the firmware on a
+ * virtual clock.
+ *
+ * Layout, all numbers little endian:
+ *   header: "GPSC", version, flags (0)
+ *   record: varint (delta_us << 1 | kind)
+ *           data records: varint length, then the bytes
+ * delta_us is the time since the previous record (since the start of the
+ * recording for the first one). A varint is 7 bits per byte, low bits
+ * first, the top bit set on all but the last byte (LEB128). A second of
+ * NMEA costs a few bytes of overhead per chunk and 3 bytes per pulse.
+ *
+ */
+#ifndef CAPTURE_H
+#define CAPTURE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define CAPTURE_VERSION 1
+#define CAPTURE_HEADER_SIZE 6
+
+// Longest data record payload
+#define CAPTURE_MAX_DATA 1024
+
+// Largest record header: 33-bit time varint and 11-bit length varint
+#define CAPTURE_MAX_OVERHEAD 7
+
+enum CAPTURE_KIND
+{
+  CAPTURE_DATA = 0, // bytes from the GPS module
+  CAPTURE_PPS = 1,  // PPS pulse
+};
+
+struct CaptureRecord {
+  uint32_t delta_us;   // since the previous record
+  uint8_t kind;        // CAPTURE_KIND
+  uint16_t len;        // data records: number of bytes
+  const uint8_t *data; // data records: the bytes, in the parsed buffer
+};
+
+size_t capture_header(uint8_t *out);
+bool capture_check_header(const uint8_t *in, size_t len);
+size_t capture_record(uint8_t *out, uint32_t delta_us, uint8_t kind, const uint8_t *data, uint16_t len);
+size_t capture_parse(const uint8_t *in, size_t len, CaptureRecord &record);
+
+#endif // CAPTURE_H
@@ -0,0 +1,73 @@
+/**
+ *
+ * Serial console command interpreter
+ * Tauno Erik
+ *
+ * Characters are fed in one at a time as they arrive, so reading the
+ * console never waits for the rest of a line. A copy of a complete line
+ * is split into arguments and run from a table of commands, the line
+ * itself stays for error messages. Everything lives in fixed buffers,
+ * nothing is allocated.
+ *
+ * Console prints text through the HAL, with print() and println() as
+ * the Arduino Serial has them.
+ *
+ */
+#ifndef CONSOLE_H
+#define CONSOLE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Longest command line in characters
+#define CONSOLE_LINE_SIZE 64
+
+// Most arguments of a command, the command name included
+#define CONSOLE_MAX_ARGS 6
+
+enum CONSOLE_RESULT
+{
+  CONSOLE_NONE = 0,     // Line not complete yet
+  CONSOLE_DONE = 1,     // Command run
+  CONSOLE_UNKNOWN = 2,  // No such command
+  CONSOLE_OVERFLOW = 3, // Line too long, dropped
+};
+
+typedef void (*console_handler)(uint8_t argc, const char *argv[]);
+
+struct ConsoleCommand {
+  const char *name;
+  console_handler handler;
+  const char *help;
+};
+
+void console_begin(const ConsoleCommand *commands, uint8_t count);
+uint8_t console_feed(char c);
+uint8_t console_execute(char *line);
+const char *console_line();
+bool console_parse_int(const char *text, int32_t &value);
+
+// Text output to the serial console
+class ConsoleOutput {
+public:
+  size_t write(const uint8_t *data, size_t len);
+  size_t print(const char *text);
+  size_t print(char c);
+  size_t print(long number);
+  size_t print(unsigned long number);
+  size_t print(int number) { return print((long)number); }
+  size_t print(unsigned int number) { return print((unsigned long)number); }
+  size_t print(unsigned char number) { return print((unsigned long)number); }
+  size_t println() { return print("\r\n"); }
+
+  template <typename T>
+  size_t println(T value)
+  {
+    size_t n = print(value);
+    return n + println();
+  }
+};
+
+extern ConsoleOutput Console;
+
+#endif // CONSOLE_H
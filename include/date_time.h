@@ -0,0 +1,40 @@
+/**
+ *
+ * Date and time helpers
+ * Tauno Erik
+ *
+ * Time is kept as an Epoch, a 64-bit count of seconds since
+ * 2000-01-01 00:00:00 UTC with the microseconds into the second, and
+ * broken down into a DateTime only for showing it. Offsets and rollovers
+ * are plain additions on the epoch; the conversions are branch-free.
+ *
+ */
+#ifndef DATE_TIME_H
+#define DATE_TIME_H
+
+#include <stdint.h>
+
+// A point in time
+struct Epoch {
+  int64_t seconds;  // since 2000-01-01 00:00:00 UTC
+  uint32_t micros;  // 0..999999
+};
+
+// A struct to store date and time
+struct DateTime {
+  int16_t year;
+  uint8_t month;   // 1..12
+  uint8_t day;     // 1..31
+  uint8_t hour;
+  uint8_t minute;
+  uint8_t second;
+  uint8_t weekday; // 0 = Sunday ... 6 = Saturday
+};
+
+int64_t date_time_to_epoch(const DateTime &dt);
+void epoch_to_date_time(int64_t seconds, DateTime &dt);
+int32_t date_to_days(int year, int month, int day);
+void days_to_date(int32_t days, DateTime &dt);
+uint8_t day_of_week(int32_t days);
+
+#endif // DATE_TIME_H
@@ -0,0 +1,27 @@
+/**
+ *
+ * Disciplined local clock with holdover
+ * Tauno Erik
+ *
+ * A software clock running on the local microsecond counter. Each GPS
+ * time (PPS pulse or NMEA sentence) steers its phase and refines an
+ * estimate of the crystal frequency error, so the clock keeps ticking
+ * accurately when the GPS fix is lost and can tell how far off it may be.
+ *
+ * Local time is passed in by the caller (micros64() on the ESP8266), which
+ * keeps the clock independent of the hardware.
+ *
+ */
+#ifndef DISCIPLINED_CLOCK_H
+#define DISCIPLINED_CLOCK_H
+
+#include <stdint.h>
+#include "date_time.h"
+
+void dclock_sync(uint64_t local_us, const Epoch &utc, uint32_t uncertainty_us);
+bool dclock_now(uint64_t local_us, Epoch &utc);
+bool dclock_is_holdover(uint64_t local_us);
+uint32_t dclock_error_us(uint64_t local_us);
+int32_t dclock_drift_ppb();
+
+#endif // DISCIPLINED_CLOCK_H
@@ -0,0 +1,31 @@
+/**
+ *
+ * 74HC595 display driver
+ * Tauno Erik
+ *
+ * Four daisy-chained 74HC595 shift registers driving the 7-segment digits.
+ * This is the display sink of the hardware abstraction layer (hal.h);
+ * without the Arduino core, the HAL backend implements it.
+ *
+ * Arduino backends:
+ *   default            - direct GPIO register writes on the given pins
+ *   DISPLAY_USE_HW_SPI - ESP8266 hardware SPI. The shift register data
+ *                        must be wired to D7 (MOSI) and clock to D5 (SCLK);
+ *                        D7 is the GPS RX pin in the default wiring.
+ *
+ * DISPLAY_BIT_ORDER (MSBFIRST or LSBFIRST) is resolved at compile time.
+ *
+ */
+#ifndef DISPLAY_H
+#define DISPLAY_H
+
+#include <stdint.h>
+
+#ifndef DISPLAY_BIT_ORDER
+#define DISPLAY_BIT_ORDER MSBFIRST
+#endif
+
+void display_begin(uint8_t data_pin, uint8_t latch_pin, uint8_t clock_pin);
+void display_write(uint32_t data);
+
+#endif // DISPLAY_H
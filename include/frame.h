@@ -0,0 +1,32 @@
+/**
+ *
+ * Display frame compositor
+ * Tauno Erik
+ *
+ * Builds the 32-bit display frame from layers (digits, dot, overlay
+ * animation) and shifts it out only when some bit actually changed.
+ * Segments are active low: 0 - ON, 1 - OFF.
+ *
+ */
+#ifndef FRAME_H
+#define FRAME_H
+
+#include <stdint.h>
+
+// Overlay that leaves all segments as they are
+#define FRAME_NO_OVERLAY 0xFFFFFFFFUL
+
+void frame_set_time(uint8_t hour, uint8_t minute);
+void frame_clear_digits();
+void frame_set_dot(bool on);
+void frame_toggle_dot();
+void frame_set_overlay(uint32_t overlay);
+void frame_overlay_step();
+bool frame_flush();
+
+void frame_text(uint32_t frame, char *text);
+
+uint32_t frame_pushed_count();
+uint32_t frame_skipped_count();
+
+#endif // FRAME_H
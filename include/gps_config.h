@@ -0,0 +1,44 @@
+/**
+ *
+ * u-blox NEO-6M receiver configuration
+ * Tauno Erik
+ *
+ * At startup the GPS module is switched from its factory defaults
+ * (9600 bps, six NMEA sentences every second) to only the messages the
+ * clock uses, at a higher baud rate. Each UBX command is acknowledged by
+ * the module; the sequence runs in the background while NMEA keeps being
+ * parsed, and the clock works with the factory defaults if it fails.
+ *
+ * The serial port is passed in by the caller, so the configuration can be
+ * tested against a simulated receiver.
+ *
+ */
+#ifndef GPS_CONFIG_H
+#define GPS_CONFIG_H
+
+#include <stdint.h>
+#include <TinyGPSUbx.h>
+
+// Baud rate after the configuration
+#define GPS_CONFIG_BAUD 115200
+
+// Navigation solution period in ms
+#define GPS_MEASURE_RATE_MS 1000
+
+enum GPS_CONFIG_STATE
+{
+  GPS_CONFIG_BUSY = 0,
+  GPS_CONFIG_DONE = 1,
+  GPS_CONFIG_FAILED = 2,
+};
+
+typedef size_t (*gps_config_write)(const uint8_t *data, size_t len);
+typedef void (*gps_config_set_baud)(uint32_t baud);
+
+void gps_config_begin(TinyGPSUbx &ubx, gps_config_write write, gps_config_set_baud set_baud, uint32_t baud, uint32_t now_ms);
+uint8_t gps_config_update(uint32_t now_ms);
+uint32_t gps_config_baud();
+uint8_t gps_config_acked();
+uint8_t gps_config_nakked();
+
+#endif // GPS_CONFIG_H
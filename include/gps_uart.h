@@ -0,0 +1,40 @@
+/**
+ *
+ * GPS module serial ingestion
+ * Tauno Erik
+ *
+ * Bytes from the GPS module are moved into a ring buffer after every pass
+ * of loop() and whenever the main loop checks for them, and the main loop
+ * takes them out in batches. Between those the SoftwareSerial buffer has
+ * to hold what arrives.
+ * Counters show how close the buffers came to overflowing.
+ *
+ */
+#ifndef GPS_UART_H
+#define GPS_UART_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Ring buffer size in bytes, ~90 ms of data at 115200 bps
+#define GPS_UART_RING_SIZE 1024
+
+// SoftwareSerial receive buffer size in bytes
+#define GPS_UART_RX_BUFFER_SIZE 256
+
+void gps_uart_begin(uint8_t rx_pin, uint8_t tx_pin, uint32_t baud);
+void gps_uart_set_baud(uint32_t baud);
+size_t gps_uart_available();
+size_t gps_uart_read(char *buffer, size_t len);
+size_t gps_uart_write(const uint8_t *data, size_t len);
+
+// Called with every chunk as it is received, e.g. to record it
+typedef void (*gps_uart_tap)(const uint8_t *data, size_t len);
+void gps_uart_set_tap(gps_uart_tap tap);
+
+uint32_t gps_uart_received();
+uint32_t gps_uart_dropped();
+uint32_t gps_uart_overflows();
+size_t gps_uart_high_water();
+
+#endif // GPS_UART_H
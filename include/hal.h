@@ -0,0 +1,72 @@
+/**
+ *
+ * Hardware abstraction layer
+ * Tauno Erik
+ *
+ * The clock talks to the hardware only through these functions, so the
+ * same main.cpp and modules run on the ESP8266 and on a PC:
+ *   clock source     - time, delay, the cycle counter and the PPS interrupt
+ *   byte streams     - the serial console and the GPS module
+ *   display sink     - display.h
+ *   persistent store - one sector of NOR flash: writing only clears
+ *                      bits, erasing sets them all
+ *
+ * Backends:
+ *   src/hal_esp8266.cpp - the ESP8266 Arduino core (env:d1_mini)
+ *   src/hal_linux.cpp   - Linux, in real time (env:native)
+ *   tools/replay        - Linux, on a virtual clock
+ *
+ */
+#ifndef HAL_H
+#define HAL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(ESP8266)
+#include <c_types.h> // IRAM_ATTR
+#endif
+
+// Interrupt handlers and everything they call run from IRAM on the ESP8266
+#ifndef IRAM_ATTR
+#define IRAM_ATTR
+#endif
+
+// Persistent store sector size in bytes
+#define HAL_STORE_SIZE 4096
+
+typedef void (*hal_callback)();
+
+// Clock source
+uint32_t hal_millis();
+uint32_t hal_micros();
+uint64_t hal_micros64();
+void hal_delay(uint32_t ms);
+uint32_t hal_cycle_count();
+uint32_t hal_cpu_mhz();
+void hal_pps_begin(uint8_t pin, hal_callback isr);
+void hal_disable_interrupts();
+void hal_enable_interrupts();
+void hal_radio_off();
+
+// Byte stream: the serial console
+void hal_console_begin(uint32_t baud);
+size_t hal_console_available();
+int hal_console_read();
+size_t hal_console_write(const uint8_t *data, size_t len);
+
+// Byte stream: the GPS module. on_receive is called in loop context
+// after loop() has returned, when data has arrived; not from an interrupt.
+void hal_gps_begin(uint8_t rx_pin, uint8_t tx_pin, uint32_t baud, size_t buffer_size, hal_callback on_receive);
+void hal_gps_end();
+size_t hal_gps_available();
+size_t hal_gps_read(uint8_t *buffer, size_t len);
+size_t hal_gps_write(const uint8_t *data, size_t len);
+bool hal_gps_overflow();
+
+// Persistent store, offsets and lengths are multiples of 4
+bool hal_store_read(uint16_t offset, uint32_t *data, uint16_t len);
+bool hal_store_write(uint16_t offset, const uint32_t *data, uint16_t len);
+bool hal_store_erase();
+
+#endif // HAL_H
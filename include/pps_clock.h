@@ -0,0 +1,24 @@
+/**
+ *
+ * PPS disciplined time
+ * Tauno Erik
+ *
+ * The GPS module PPS output marks the start of each UTC second.
+ * Each pulse is timestamped with the CPU cycle counter in an interrupt
+ * and paired with the time of the following RMC/ZDA sentence, so the
+ * current UTC time can be interpolated to the microsecond.
+ *
+ */
+#ifndef PPS_CLOCK_H
+#define PPS_CLOCK_H
+
+#include <stdint.h>
+#include "date_time.h"
+
+void pps_begin(uint8_t pin);
+void pps_set_time(int64_t seconds, uint8_t centisecond);
+bool pps_now(Epoch &now);
+uint32_t pps_pulse_count();
+uint32_t pps_edge_age_us();
+
+#endif // PPS_CLOCK_H
@@ -0,0 +1,47 @@
+/**
+ *
+ * GPS input recorder
+ * Tauno Erik
+ *
+ * Records the bytes from the GPS module and the PPS pulses to a capture
+ * file (see capture.h) on LittleFS, for replaying on a PC with
+ * tools/replay. Records are collected in a fixed RAM buffer and written
+ * to the file from the main loop by recorder_flush(), so the receive path
+ * never waits for the flash. When the buffer is full, records are dropped
+ * and counted; a recording stops by itself when the file reaches
+ * RECORDER_MAX_FILE_SIZE or the file system is full.
+ *
+ * Time is passed in by the caller (micros()).
+ *
+ */
+#ifndef RECORDER_H
+#define RECORDER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// RAM buffer size in bytes, about a second of data at 115200 bps
+#define RECORDER_BUFFER_SIZE 2048
+
+// The recording stops at this file size, about 1.5 hours of the
+// configured messages
+#define RECORDER_MAX_FILE_SIZE (1024UL * 1024UL)
+
+#define RECORDER_DEFAULT_PATH "/capture.bin"
+
+bool recorder_start(const char *path, uint32_t now_us);
+void recorder_stop();
+bool recorder_active();
+void recorder_data(uint32_t time_us, const uint8_t *data, size_t len);
+void recorder_pps(uint32_t time_us);
+bool recorder_flush();
+
+const char *recorder_path();
+uint32_t recorder_file_size();
+uint32_t recorder_records();
+uint32_t recorder_dropped();
+
+typedef size_t (*recorder_write)(const uint8_t *data, size_t len);
+int32_t recorder_dump(const char *path, recorder_write write);
+
+#endif // RECORDER_H
@@ -0,0 +1,76 @@
+/**
+ *
+ * Lock-free single-producer/single-consumer ring buffer
+ * Tauno Erik
+ *
+ * One side (e.g. an interrupt) only pushes, the other only pops.
+ * Each index is written by one side only, so no locking is needed on a
+ * single core; the fences keep the compiler from reordering the data
+ * accesses around the index updates.
+ *
+ */
+#ifndef RING_BUFFER_H
+#define RING_BUFFER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+
+template <size_t SIZE>
+class RingBuffer {
+  static_assert(SIZE >= 2 && (SIZE & (SIZE - 1)) == 0, "Ring buffer size must be a power of two");
+  static_assert(SIZE <= 32768, "Ring buffer indices are 16-bit");
+
+public:
+  // Producer side. @return number of bytes stored, the rest did not fit
+  size_t push(const uint8_t *data, size_t len)
+  {
+    uint16_t h = head;
+    size_t room = SIZE - (uint16_t)(h - tail);
+    if (len > room)
+    {
+      len = room;
+    }
+
+    for (size_t i = 0; i < len; i++)
+    {
+      buffer[(h + i) & (SIZE - 1)] = data[i];
+    }
+
+    std::atomic_signal_fence(std::memory_order_release);
+    head = h + len;
+    return len;
+  }
+
+  // Consumer side. @return number of bytes copied to data
+  size_t pop(uint8_t *data, size_t len)
+  {
+    uint16_t t = tail;
+    uint16_t used = head - t;
+    std::atomic_signal_fence(std::memory_order_acquire);
+    if (len > used)
+    {
+      len = used;
+    }
+
+    for (size_t i = 0; i < len; i++)
+    {
+      data[i] = buffer[(t + i) & (SIZE - 1)];
+    }
+
+    std::atomic_signal_fence(std::memory_order_release);
+    tail = t + len;
+    return len;
+  }
+
+  size_t size() const     { return (uint16_t)(head - tail); }
+  size_t capacity() const { return SIZE; }
+
+private:
+  // Free running indices, wrap at 2^16
+  volatile uint16_t head = 0; // written by the producer
+  volatile uint16_t tail = 0; // written by the consumer
+  uint8_t buffer[SIZE];
+};
+
+#endif // RING_BUFFER_H
@@ -0,0 +1,35 @@
+/**
+ *
+ * Cooperative scheduler
+ * Tauno Erik
+ *
+ * Timers and events for the main loop: work runs only when a timer is
+ * due or an event has been posted, the rest of the time the chip idles.
+ * Time is passed in by the caller, so the scheduler has no hardware
+ * dependencies.
+ *
+ */
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <stdint.h>
+
+// Maximum number of timers
+#define SCHED_MAX_TIMERS 8
+
+// Maximum number of events
+#define SCHED_MAX_EVENTS 16
+
+typedef void (*sched_callback)();
+
+void sched_on(uint8_t event, sched_callback callback);
+void sched_post(uint8_t event);
+bool sched_pending();
+
+int8_t sched_timer(uint32_t now_ms, uint32_t period_ms, sched_callback callback);
+int8_t sched_timeout(uint32_t now_ms, uint32_t delay_ms, sched_callback callback);
+void sched_restart(int8_t timer, uint32_t now_ms, uint32_t delay_ms);
+
+uint32_t sched_dispatch(uint32_t now_ms);
+
+#endif // SCHEDULER_H
@@ -0,0 +1,30 @@
+/**
+ *
+ * Wear-levelled settings store
+ * Tauno Erik
+ *
+ * Settings are appended as records to one flash sector (the one the
+ * EEPROM library used) instead of rewriting the sector on every change.
+ * Each record has a magic number, a layout version, a sequence number and
+ * a CRC; the newest valid record wins. The sector is erased only when it
+ * is full: a record is an 8-byte header, the settings padded to 32 bits
+ * and a 4-byte CRC, so the 4 KB sector holds 68 records of the largest
+ * (48-byte) settings and more of smaller ones. Unchanged settings are
+ * not written at all. No RAM mirror of the sector is kept.
+ *
+ */
+#ifndef SETTINGS_STORE_H
+#define SETTINGS_STORE_H
+
+#include <stdint.h>
+
+// Largest settings struct in bytes
+#define SETTINGS_STORE_MAX_SIZE 48
+
+uint8_t settings_store_load(void *data, uint8_t size);
+bool settings_store_save(const void *data, uint8_t size, uint8_t version);
+bool settings_store_read_legacy(void *data, uint8_t size);
+uint32_t settings_store_sequence();
+uint16_t settings_store_used();
+
+#endif // SETTINGS_STORE_H
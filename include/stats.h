@@ -0,0 +1,92 @@
+/**
+ *
+ * Timing statistics
+ * Tauno Erik
+ *
+ * Histograms of the time between GPS seconds (jitter), the time from
+ * the '$' of a sentence to its commit (reception and parsing), the delay
+ * from the PPS pulse to the time sentence and the main loop run time,
+ * plus the GPS data rate. Shown by the STATS command, or dumped as one
+ * binary StatsDump record for a host tool.
+ *
+ * Time is passed in by the caller, so the module has no hardware
+ * dependencies.
+ *
+ */
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdint.h>
+
+// Histogram bins, limits in stats_bin_limit()
+#define STATS_BINS 8
+
+// Sentence types counted by TinyGPSPlus (GPS_SENTENCE_TYPES)
+#define STATS_SENTENCE_TYPES 9
+
+enum STATS_HISTOGRAMS
+{
+  STATS_JITTER = 0,      // GPS second interval, distance from a whole second
+  STATS_SENTENCE = 1,    // '$' to commit of the last sentence of a UART read
+  STATS_PPS_LATENCY = 2, // PPS pulse to the time sentence
+  STATS_LOOP = 3,        // main loop run time, without idling
+  STATS_HISTOGRAM_COUNT = 4,
+};
+
+// Microseconds; the bins saturate instead of wrapping
+struct StatsHistogram {
+  uint32_t count;
+  uint32_t max_us;
+  uint64_t sum_us;
+  uint16_t bins[STATS_BINS];
+};
+
+#define STATS_DUMP_MAGIC 0x5453 // "ST"
+#define STATS_DUMP_VERSION 1
+
+// Binary dump, little-endian, sent as is by STATS BIN
+struct StatsDump {
+  uint16_t magic;
+  uint8_t version;
+  uint8_t bins;        // STATS_BINS
+  uint16_t size;       // sizeof(StatsDump)
+  uint16_t sentence_types; // STATS_SENTENCE_TYPES
+  uint32_t uptime_ms;
+
+  // TinyGPSPlus and TinyGPSUbx
+  uint32_t chars;
+  uint32_t passed;
+  uint32_t failed;
+  uint32_t with_fix;
+  uint32_t sentences[STATS_SENTENCE_TYPES];
+  uint32_t ubx_frames;
+  uint32_t ubx_failed;
+
+  // GPS serial port
+  uint32_t uart_received;
+  uint32_t uart_dropped;
+  uint32_t uart_overflows;
+  uint32_t uart_high_water;
+
+  // Display
+  uint32_t frames_pushed;
+  uint32_t frames_skipped;
+
+  // This module
+  uint32_t bytes_per_second;
+  uint32_t max_bytes_per_second;
+  StatsHistogram histograms[STATS_HISTOGRAM_COUNT];
+};
+
+void stats_reset();
+void stats_add(uint8_t histogram, uint32_t us);
+void stats_second(uint32_t now_us);
+void stats_bytes(uint32_t received, uint32_t now_ms);
+
+const StatsHistogram &stats_histogram(uint8_t histogram);
+uint32_t stats_bin_limit(uint8_t bin);
+uint32_t stats_bytes_per_second();
+uint32_t stats_max_bytes_per_second();
+void stats_fill_dump(StatsDump &dump);
+
+#endif // STATS_H
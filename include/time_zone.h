@@ -0,0 +1,60 @@
+/**
+ *
+ * Time zones with daylight saving time rules
+ * Tauno Erik
+ *
+ * Time zones are given as POSIX TZ strings, e.g.
+ *   EET-2EEST,M3.5.0/3,M10.5.0/4   (Estonia, Finland, ...)
+ *   CET-1CEST,M3.5.0,M10.5.0/3     (Central Europe)
+ *   AEST-10AEDT,M10.1.0,M4.1.0/3   (Sydney)
+ *   <+03>-3                        (fixed offset, no DST)
+ * Note that the POSIX offset is west of UTC: UTC+2 is written -2.
+ *
+ * The offset and the UTC instant of the next (and previous) transition
+ * are cached, so converting the time every second is a comparison and
+ * an addition; the rules are evaluated again only when a transition is
+ * passed, i.e. twice a year.
+ *
+ */
+#ifndef TIME_ZONE_H
+#define TIME_ZONE_H
+
+#include <stdint.h>
+#include "date_time.h"
+
+// Longest POSIX TZ string, with the terminating zero
+#define TZ_RULE_SIZE 40
+#define TZ_NAME_SIZE 8
+
+// When in the year a transition happens
+struct TzTransition {
+  uint8_t type;   // 'M': month.week.weekday, 'J': Julian day 1..365, 'D': day 0..365
+  uint8_t month;  // 1..12
+  uint8_t week;   // 1..5, 5 is the last week of the month
+  uint8_t weekday; // 0..6, 0 is Sunday
+  uint16_t day;   // for 'J' and 'D'
+  int32_t time;   // seconds after local midnight, may be negative or past 24h
+};
+
+struct TimeZone {
+  char std_name[TZ_NAME_SIZE];
+  char dst_name[TZ_NAME_SIZE];
+  int32_t std_offset; // seconds east of UTC
+  int32_t dst_offset;
+  bool has_dst;
+  TzTransition start, end;
+
+  // Cached interval [valid_from, valid_until) with a constant offset
+  int64_t valid_from;
+  int64_t valid_until;
+  int32_t offset;
+  bool is_dst;
+};
+
+bool tz_parse(TimeZone &tz, const char *rule);
+void tz_fixed(TimeZone &tz, int32_t offset);
+int32_t tz_offset(TimeZone &tz, int64_t seconds);
+void tz_local(TimeZone &tz, int64_t seconds, DateTime &dt);
+const char *tz_name(const TimeZone &tz);
+
+#endif // TIME_ZONE_H
@@ -0,0 +1,59 @@
+#include <TinyGPSPlus.h>
+#include <SoftwareSerial.h>
+/*
+   This sample code demonstrates the built-in satellite table.
+
+   TinyGPSPlus parses $xxGSV sequences directly into gps.satellitesInView,
+   so the satellite numbers, elevation, azimuth and signal-to-noise ratio
+   of every constellation are available without any TinyGPSCustom objects
+   (compare with SatelliteTracker.ino).
+
+   It requires the use of SoftwareSerial, and assumes that you have a
+   4800-baud serial GPS device hooked up on pins 4(RX) and 3(TX).
+*/
+static const int RXPin = 4, TXPin = 3;
+static const uint32_t GPSBaud = 4800;
+
+// The TinyGPSPlus object
+TinyGPSPlus gps;
+
+// The serial connection to the GPS device
+SoftwareSerial ss(RXPin, TXPin);
+
+void setup()
+{
+  Serial.begin(115200);
+  ss.begin(GPSBaud);
+
+  Serial.println(F("SatelliteTable.ino"));
+  Serial.println(F("Monitoring satellite location and signal strength using the satellite table"));
+  Serial.print(F("Testing TinyGPSPlus library v. ")); Serial.println(TinyGPSPlus::libraryVersion());
+  Serial.println(F("by Mikal Hart"));
+  Serial.println();
+}
+
+void loop()
+{
+  // Dispatch incoming characters
+  while (ss.available() > 0)
+    gps.encode(ss.read());
+
+  if (gps.satellitesInView.isUpdated())
+  {
+    uint8_t count = gps.satellitesInView.count();
+
+    Serial.print(F("Sats=")); Serial.print(count);
+    Serial.print(F(" GPS=")); Serial.print(gps.satellitesInView.count(TinyGPSSatellites::GPS));
+    Serial.print(F(" GLONASS=")); Serial.println(gps.satellitesInView.count(TinyGPSSatellites::GLONASS));
+
+    for (uint8_t i = 0; i < count; ++i)
+    {
+      Serial.print((char)gps.satellitesInView.constellation(i));
+      Serial.print(gps.satellitesInView.prn(i));
+      Serial.print(F(" Elevation=")); Serial.print(gps.satellitesInView.elevation(i));
+      Serial.print(F(" Azimuth=")); Serial.print(gps.satellitesInView.azimuth(i));
+      Serial.print(F(" SNR=")); Serial.println(gps.satellitesInView.snr(i));
+    }
+    Serial.println();
+  }
+}
@@ -27,10 +27,9 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 #include <ctype.h>
 #include <stdlib.h>
 
-#define _RMCterm "RMC"
-#define _GGAterm "GGA"
-
 #if !defined(ARDUINO) && !defined(__AVR__)
+#include <chrono>
+
 // Alternate implementation of millis() that relies on std
 unsigned long millis()
 {
@@ -41,23 +40,47 @@ unsigned long millis()
 
     return static_cast<unsigned long>(duration.count());
 }
+
+unsigned long micros()
+{
+    static auto start_time = std::chrono::high_resolution_clock::now();
+
+    auto end_time = std::chrono::high_resolution_clock::now();
+    auto duration = std::chrono::duration_cast<std::chrono::microseconds>(end_time - start_time);
+
+    return static_cast<unsigned long>(duration.count());
+}
 #endif
 
 TinyGPSPlus::TinyGPSPlus()
   :  parity(0)
   ,  isChecksumTerm(false)
+  ,  inSentence(false)
   ,  curSentenceType(GPS_SENTENCE_OTHER)
   ,  curTermNumber(0)
   ,  curTermOffset(0)
   ,  sentenceHasFix(false)
+  ,  sentenceHasTime(false)
+  ,  sentenceHasDate(false)
+#if _GPS_HAS(_GPS_FEATURE_CUSTOM)
   ,  customElts(0)
   ,  customCandidates(0)
+  ,  customSlotMask(0)
+#endif
+#if _GPS_HAS(_GPS_FEATURE_STATS)
   ,  encodedCharCount(0)
   ,  sentencesWithFixCount(0)
   ,  failedChecksumCount(0)
   ,  passedChecksumCount(0)
+  ,  sentenceStartTime(0)
+  ,  lastSentenceTime(0)
+#endif
 {
   term[0] = '\0';
+  memset(&dateTimeSnapshot, 0, sizeof(dateTimeSnapshot));
+#if _GPS_HAS(_GPS_FEATURE_STATS)
+  memset(sentenceCounts, 0, sizeof(sentenceCounts));
+#endif
 }
 
 //
@@ -66,21 +89,34 @@ TinyGPSPlus::TinyGPSPlus()
 
 bool TinyGPSPlus::encode(char c)
 {
+#if _GPS_HAS(_GPS_FEATURE_STATS)
   ++encodedCharCount;
+#endif
 
   switch(c)
   {
   case ',': // term terminators
-    parity ^= (uint8_t)c;
+    if (!isChecksumTerm)
+      parity ^= (uint8_t)c;
   case '\r':
   case '\n':
   case '*':
     {
       bool isValidSentence = false;
-      if (curTermOffset < sizeof(term))
+      if (inSentence)
       {
-        term[curTermOffset] = 0;
-        isValidSentence = endOfTermHandler();
+        if (curTermOffset == sizeof(term) && curSentenceType < GPS_SENTENCE_TXT)
+          rejectSentence(); // a field too long to be parsed
+        else if (curTermNumber == UINT8_MAX)
+          rejectSentence(); // the term numbers would wrap around
+        else if ((c == '\r' || c == '\n') && !isChecksumTerm)
+          rejectSentence(); // the line ended before the checksum
+        else
+        {
+          // Overlong free text (TXT, unknown sentences) is cut short
+          term[curTermOffset < sizeof(term) ? curTermOffset : sizeof(term) - 1] = 0;
+          isValidSentence = endOfTermHandler();
+        }
       }
       ++curTermNumber;
       curTermOffset = 0;
@@ -94,11 +130,24 @@ bool TinyGPSPlus::encode(char c)
     parity = 0;
     curSentenceType = GPS_SENTENCE_OTHER;
     isChecksumTerm = false;
+    inSentence = true;
     sentenceHasFix = false;
+    sentenceHasTime = false;
+    sentenceHasDate = false;
+#if _GPS_HAS(_GPS_FEATURE_STATS)
+    sentenceStartTime = micros();
+#endif
     return false;
 
   default: // ordinary characters
-    if (curTermOffset < sizeof(term) - 1)
+    if ((uint8_t)c < ' ' || (uint8_t)c > '~')
+    {
+      // Not NMEA text: line noise or part of a binary message
+      if (inSentence)
+        rejectSentence();
+      return false;
+    }
+    if (curTermOffset < sizeof(term))
       term[curTermOffset++] = c;
     if (!isChecksumTerm)
       parity ^= c;
@@ -108,59 +157,181 @@ bool TinyGPSPlus::encode(char c)
   return false;
 }
 
+// Block-oriented variant of encode(char) for draining a whole UART chunk
+// in one call. Ordinary characters (printable ASCII from '-' up) are
+// gathered into the current term by a tight inner loop; the term
+// delimiters, '$' and all other bytes go through the per-character state
+// machine, so the committed state is exactly the same as feeding the
+// bytes one at a time.
+// Returns the number of sentences that passed the checksum test.
+size_t TinyGPSPlus::encode(const char *buf, size_t len)
+{
+  const char *end = buf + len;
+  size_t validSentences = 0;
+
+  while (buf < end)
+  {
+#if _GPS_HAS(_GPS_FEATURE_STATS)
+    const char *start = buf;
+#endif
+    uint8_t offset = curTermOffset;
+    uint8_t newParity = parity;
+
+    while (buf < end && (uint8_t)(*buf - '-') <= '~' - '-')
+    {
+      char c = *buf++;
+      if (offset < sizeof(term))
+        term[offset++] = c;
+      newParity ^= c;
+    }
+
+    curTermOffset = offset;
+    if (!isChecksumTerm)
+      parity = newParity;
+#if _GPS_HAS(_GPS_FEATURE_STATS)
+    encodedCharCount += buf - start;
+#endif
+
+    if (buf < end && encode(*buf++))
+      ++validSentences;
+  }
+
+  return validSentences;
+}
+
+#if _GPS_HAS(_GPS_FEATURE_STATS)
+// static
+const char *TinyGPSPlus::sentenceTypeName(uint8_t type)
+{
+  static const char *const names[GPS_SENTENCE_TYPES] =
+    {"GGA", "RMC", "GSV", "GSA", "VTG", "ZDA", "GLL", "TXT", "other"};
+  return type < GPS_SENTENCE_TYPES ? names[type] : "";
+}
+#endif
+
 //
 // internal utilities
 //
+// Value of a hex digit, -1 for any other character
 int TinyGPSPlus::fromHex(char a)
 {
   if (a >= 'A' && a <= 'F')
     return a - 'A' + 10;
   else if (a >= 'a' && a <= 'f')
     return a - 'a' + 10;
-  else
+  else if (a >= '0' && a <= '9')
     return a - '0';
+  else
+    return -1;
+}
+
+// Drops the sentence being parsed; nothing of it is committed and it is
+// counted with the checksum failures
+void TinyGPSPlus::rejectSentence()
+{
+  inSentence = false;
+#if _GPS_HAS(_GPS_FEATURE_STATS)
+  ++failedChecksumCount;
+#endif
+}
+
+// Classify a packed sentence ID; the talker is the upper two characters
+// and the sentence type the lower three (see sentenceId())
+#define _GPS_TALKER(id) ((id) >> 18)
+#define _GPS_TYPE(id) ((id) & 0x3FFFFUL)
+
+uint8_t TinyGPSPlus::sentenceType(uint32_t id)
+{
+  switch(_GPS_TALKER(id))
+  {
+  case sentenceId("GP"): // GPS
+  case sentenceId("GN"): // combined GNSS
+  case sentenceId("GA"): // Galileo
+  case sentenceId("GB"): // BeiDou
+  case sentenceId("GL"): // GLONASS
+    break;
+  default:
+    return GPS_SENTENCE_OTHER;
+  }
+
+  switch(_GPS_TYPE(id))
+  {
+  case sentenceId("RMC"): return GPS_SENTENCE_RMC;
+  case sentenceId("GGA"): return GPS_SENTENCE_GGA;
+  case sentenceId("GSV"): return GPS_SENTENCE_GSV;
+  case sentenceId("GSA"): return GPS_SENTENCE_GSA;
+  case sentenceId("VTG"): return GPS_SENTENCE_VTG;
+  case sentenceId("ZDA"): return GPS_SENTENCE_ZDA;
+  case sentenceId("GLL"): return GPS_SENTENCE_GLL;
+  case sentenceId("TXT"): return GPS_SENTENCE_TXT;
+  default:                return GPS_SENTENCE_OTHER;
+  }
+}
+
+// static
+// Parse the leading digits of a term; values that don't fit saturate
+uint32_t TinyGPSPlus::parseUnsigned(const char *term)
+{
+  uint32_t ret = 0;
+  for (; isdigit((unsigned char)*term); ++term)
+  {
+    uint8_t digit = *term - '0';
+    if (ret < UINT32_MAX / 10 || (ret == UINT32_MAX / 10 && digit <= UINT32_MAX % 10))
+      ret = 10 * ret + digit;
+    else
+      ret = UINT32_MAX;
+  }
+  return ret;
 }
 
 // static
-// Parse a (potentially negative) number with up to 2 decimal digits -xxxx.yy
+// Parse a (potentially negative) number with up to 2 decimal digits -xxxx.yy;
+// values beyond the range of int32_t saturate
 int32_t TinyGPSPlus::parseDecimal(const char *term)
 {
   bool negative = *term == '-';
   if (negative) ++term;
-  int32_t ret = 100 * (int32_t)atol(term);
-  while (isdigit(*term)) ++term;
-  if (*term == '.' && isdigit(term[1]))
+  uint32_t ret = parseUnsigned(term);
+  ret = ret <= INT32_MAX / 100 ? 100 * ret : INT32_MAX / 100 * 100;
+  while (isdigit((unsigned char)*term)) ++term;
+  if (*term == '.' && isdigit((unsigned char)term[1]))
   {
     ret += 10 * (term[1] - '0');
-    if (isdigit(term[2]))
+    if (isdigit((unsigned char)term[2]))
       ret += term[2] - '0';
   }
-  return negative ? -ret : ret;
+  if (ret > INT32_MAX)
+    ret = INT32_MAX;
+  return negative ? -(int32_t)ret : (int32_t)ret;
 }
 
 // static
-// Parse degrees in that funny NMEA format DDMM.MMMM
-void TinyGPSPlus::parseDegrees(const char *term, RawDegrees &deg)
+// Parse degrees in that funny NMEA format DDMM.MMMM. Returns false, leaving
+// deg as it was, if there are more than 180 degrees or 60 minutes.
+bool TinyGPSPlus::parseDegrees(const char *term, RawDegrees &deg)
 {
-  uint32_t leftOfDecimal = (uint32_t)atol(term);
+  uint32_t leftOfDecimal = parseUnsigned(term);
   uint16_t minutes = (uint16_t)(leftOfDecimal % 100);
   uint32_t multiplier = 10000000UL;
   uint32_t tenMillionthsOfMinutes = minutes * multiplier;
 
-  deg.deg = (int16_t)(leftOfDecimal / 100);
+  if (leftOfDecimal / 100 > 180 || minutes >= 60)
+    return false;
 
-  while (isdigit(*term))
+  while (isdigit((unsigned char)*term))
     ++term;
 
   if (*term == '.')
-    while (isdigit(*++term))
+    while (isdigit((unsigned char)*++term))
     {
       multiplier /= 10;
       tenMillionthsOfMinutes += (*term - '0') * multiplier;
     }
 
+  deg.deg = (uint16_t)(leftOfDecimal / 100);
   deg.billionths = (5 * tenMillionthsOfMinutes + 1) / 3;
   deg.negative = false;
+  return true;
 }
 
 #define COMBINE(sentence_type, term_number) (((unsigned)(sentence_type) << 5) | term_number)
@@ -172,47 +343,97 @@ bool TinyGPSPlus::endOfTermHandler()
   // If it's the checksum term, and the checksum checks out, commit
   if (isChecksumTerm)
   {
-    byte checksum = 16 * fromHex(term[0]) + fromHex(term[1]);
-    if (checksum == parity)
+    // The sentence ends here, with exactly two hex digits
+    inSentence = false;
+    int hi = fromHex(term[0]);
+    int lo = hi < 0 ? -1 : fromHex(term[1]);
+    if (lo >= 0 && term[2] == '\0' && 16 * hi + lo == parity)
     {
+#if _GPS_HAS(_GPS_FEATURE_STATS)
       passedChecksumCount++;
       if (sentenceHasFix)
         ++sentencesWithFixCount;
+      ++sentenceCounts[curSentenceType];
+      lastSentenceTime = micros() - sentenceStartTime;
+#endif
 
+      // One clock read for every value the sentence commits
+      uint32_t now;
       switch(curSentenceType)
       {
       case GPS_SENTENCE_RMC:
-        date.commit();
-        time.commit();
+        now = millis();
+        // Before the first fix the fields can be empty: "$GPRMC,,V,,,,,,,,,,N"
+        if (sentenceHasTime)
+          time.commit(now);
+        if (sentenceHasDate)
+          date.commit(now);
+        if (sentenceHasTime && sentenceHasDate)
+          commitDateTime(false);
         if (sentenceHasFix)
         {
-           location.commit();
-           speed.commit();
-           course.commit();
+#if _GPS_HAS(_GPS_FEATURE_LOCATION)
+           location.commit(now);
+#endif
+#if _GPS_HAS(_GPS_FEATURE_SPEED)
+           speed.commit(now);
+#endif
+#if _GPS_HAS(_GPS_FEATURE_COURSE)
+           course.commit(now);
+#endif
         }
         break;
       case GPS_SENTENCE_GGA:
-        time.commit();
+        now = millis();
+        if (sentenceHasTime)
+          time.commit(now);
         if (sentenceHasFix)
         {
-          location.commit();
-          altitude.commit();
+#if _GPS_HAS(_GPS_FEATURE_LOCATION)
+          location.commit(now);
+#endif
+#if _GPS_HAS(_GPS_FEATURE_ALTITUDE)
+          altitude.commit(now);
+#endif
         }
-        satellites.commit();
-        hdop.commit();
+#if _GPS_HAS(_GPS_FEATURE_SATELLITES)
+        satellites.commit(now);
+#endif
+#if _GPS_HAS(_GPS_FEATURE_HDOP)
+        hdop.commit(now);
+#endif
         break;
+      case GPS_SENTENCE_ZDA:
+        if (sentenceHasTime && sentenceHasDate)
+        {
+          now = millis();
+          date.commit(now);
+          time.commit(now);
+          commitDateTime(false);
+        }
+        break;
+#if _GPS_HAS(_GPS_FEATURE_GSV)
+      case GPS_SENTENCE_GSV:
+        satellitesInView.commit(millis());
+        break;
+#endif
       }
 
+#if _GPS_HAS(_GPS_FEATURE_CUSTOM)
       // Commit all custom listeners of this sentence type
-      for (TinyGPSCustom *p = customCandidates; p != NULL && strcmp(p->sentenceName, customCandidates->sentenceName) == 0; p = p->next)
-         p->commit();
+      if (customCandidates != NULL)
+        for (TinyGPSCustom *p = customCandidates; p != customCandidates->nextSentence; p = p->next)
+          p->commit(millis());
+#endif
       return true;
     }
 
+#if _GPS_HAS(_GPS_FEATURE_STATS)
     else
     {
       ++failedChecksumCount;
     }
+#endif
 
     return false;
   }
@@ -220,34 +441,88 @@ bool TinyGPSPlus::endOfTermHandler()
   // the first term determines the sentence type
   if (curTermNumber == 0)
   {
-    if (term[0] == 'G' && strchr("PNABL", term[1]) != NULL && !strcmp(term + 2, _RMCterm))
-      curSentenceType = GPS_SENTENCE_RMC;
-    else if (term[0] == 'G' && strchr("PNABL", term[1]) != NULL && !strcmp(term + 2, _GGAterm))
-      curSentenceType = GPS_SENTENCE_GGA;
-    else
-      curSentenceType = GPS_SENTENCE_OTHER;
+    uint32_t id = sentenceId(term);
+    curSentenceType = sentenceType(id);
+#if _GPS_HAS(_GPS_FEATURE_GSV)
+    if (curSentenceType == GPS_SENTENCE_GSV)
+    {
+      // Nothing staged until the part number and satellite count arrive
+      satellitesInView.newConstellation = term[1];
+      satellitesInView.newPart = satellitesInView.newPartSats = 0;
+    }
+#endif
+    // Day, month and year must all come from this sentence
+    if (curSentenceType == GPS_SENTENCE_ZDA)
+      date.newDate = 0;
 
+#if _GPS_HAS(_GPS_FEATURE_CUSTOM)
     // Any custom candidates of this sentence type?
-    for (customCandidates = customElts; customCandidates != NULL && strcmp(customCandidates->sentenceName, term) < 0; customCandidates = customCandidates->next);
-    if (customCandidates != NULL && strcmp(customCandidates->sentenceName, term) > 0)
-       customCandidates = NULL;
+    selectCustomCandidates(id);
+#endif
 
     return false;
   }
 
-  if (curSentenceType != GPS_SENTENCE_OTHER && term[0])
+#if _GPS_HAS(_GPS_FEATURE_GSV)
+  // GSV terms may be empty (SNR of a satellite that isn't tracked)
+  if (curSentenceType == GPS_SENTENCE_GSV)
+    satellitesInView.setTerm(curTermNumber, term);
+#endif
+
+  // Only the first 32 term numbers are distinct in COMBINE()
+  bool wellFormed = true;
+  if (curSentenceType != GPS_SENTENCE_OTHER && term[0] && curTermNumber < 32)
     switch(COMBINE(curSentenceType, curTermNumber))
   {
-    case COMBINE(GPS_SENTENCE_RMC, 1): // Time in both sentences
+    case COMBINE(GPS_SENTENCE_RMC, 1): // Time in all three sentences
     case COMBINE(GPS_SENTENCE_GGA, 1):
-      time.setTime(term);
+    case COMBINE(GPS_SENTENCE_ZDA, 1):
+      wellFormed = time.setTime(term);
+      sentenceHasTime = wellFormed;
+      break;
+    case COMBINE(GPS_SENTENCE_ZDA, 2): // Day, month and year (ZDA)
+      {
+        uint32_t day = parseUnsigned(term);
+        wellFormed = day >= 1 && day <= 31;
+        if (wellFormed)
+          date.newDate = day * 10000;
+      }
+      break;
+    case COMBINE(GPS_SENTENCE_ZDA, 3):
+      {
+        uint32_t month = parseUnsigned(term);
+        wellFormed = month >= 1 && month <= 12;
+        if (wellFormed)
+          date.newDate += month * 100;
+      }
+      break;
+    case COMBINE(GPS_SENTENCE_ZDA, 4):
+      {
+        uint32_t year = parseUnsigned(term);
+        wellFormed = year >= 2000 && year <= 2099;
+        if (wellFormed)
+          date.newDate += year % 100;
+        // An empty day or month term leaves its digits zero
+        sentenceHasDate = wellFormed && date.newDate / 10000 != 0 && date.newDate / 100 % 100 != 0;
+      }
       break;
     case COMBINE(GPS_SENTENCE_RMC, 2): // RMC validity
       sentenceHasFix = term[0] == 'A';
       break;
+    case COMBINE(GPS_SENTENCE_RMC, 9): // Date (RMC)
+      wellFormed = date.setDate(term);
+      sentenceHasDate = wellFormed;
+      break;
+    case COMBINE(GPS_SENTENCE_GGA, 6): // Fix data (GGA)
+      sentenceHasFix = term[0] > '0';
+#if _GPS_HAS(_GPS_FEATURE_LOCATION)
+      location.newFixQuality = (TinyGPSLocation::Quality)term[0];
+#endif
+      break;
+#if _GPS_HAS(_GPS_FEATURE_LOCATION)
     case COMBINE(GPS_SENTENCE_RMC, 3): // Latitude
     case COMBINE(GPS_SENTENCE_GGA, 2):
-      location.setLatitude(term);
+      wellFormed = location.setLatitude(term);
       break;
     case COMBINE(GPS_SENTENCE_RMC, 4): // N/S
     case COMBINE(GPS_SENTENCE_GGA, 3):
@@ -255,47 +530,101 @@ bool TinyGPSPlus::endOfTermHandler()
       break;
     case COMBINE(GPS_SENTENCE_RMC, 5): // Longitude
     case COMBINE(GPS_SENTENCE_GGA, 4):
-      location.setLongitude(term);
+      wellFormed = location.setLongitude(term);
       break;
     case COMBINE(GPS_SENTENCE_RMC, 6): // E/W
     case COMBINE(GPS_SENTENCE_GGA, 5):
       location.rawNewLngData.negative = term[0] == 'W';
       break;
+    case COMBINE(GPS_SENTENCE_RMC, 12):
+      location.newFixMode = (TinyGPSLocation::Mode)term[0];
+      break;
+#endif
+#if _GPS_HAS(_GPS_FEATURE_SPEED)
     case COMBINE(GPS_SENTENCE_RMC, 7): // Speed (RMC)
       speed.set(term);
       break;
+#endif
+#if _GPS_HAS(_GPS_FEATURE_COURSE)
     case COMBINE(GPS_SENTENCE_RMC, 8): // Course (RMC)
       course.set(term);
       break;
-    case COMBINE(GPS_SENTENCE_RMC, 9): // Date (RMC)
-      date.setDate(term);
-      break;
-    case COMBINE(GPS_SENTENCE_GGA, 6): // Fix data (GGA)
-      sentenceHasFix = term[0] > '0';
-      location.newFixQuality = (TinyGPSLocation::Quality)term[0];
-      break;
+#endif
+#if _GPS_HAS(_GPS_FEATURE_SATELLITES)
     case COMBINE(GPS_SENTENCE_GGA, 7): // Satellites used (GGA)
       satellites.set(term);
       break;
+#endif
+#if _GPS_HAS(_GPS_FEATURE_HDOP)
     case COMBINE(GPS_SENTENCE_GGA, 8): // HDOP
       hdop.set(term);
       break;
+#endif
+#if _GPS_HAS(_GPS_FEATURE_ALTITUDE)
     case COMBINE(GPS_SENTENCE_GGA, 9): // Altitude (GGA)
       altitude.set(term);
       break;
-    case COMBINE(GPS_SENTENCE_RMC, 12):
-      location.newFixMode = (TinyGPSLocation::Mode)term[0];
-      break;
+#endif
+  }
+
+  // A value out of range doesn't come from a working receiver
+  if (!wellFormed)
+  {
+    rejectSentence();
+    return false;
   }
 
+#if _GPS_HAS(_GPS_FEATURE_CUSTOM)
   // Set custom values as needed
-  for (TinyGPSCustom *p = customCandidates; p != NULL && strcmp(p->sentenceName, customCandidates->sentenceName) == 0 && p->termNumber <= curTermNumber; p = p->next)
-    if (p->termNumber == curTermNumber)
-         p->set(term);
+  if (customCandidates != NULL)
+    setCustomCandidates();
+#endif
 
   return false;
 }
 
+#if _GPS_HAS(_GPS_FEATURE_CUSTOM)
+// Find the custom elements listening to the sentence that just started and
+// index them by term number, so each following term is a single lookup
+void TinyGPSPlus::selectCustomCandidates(uint32_t id)
+{
+  for (customCandidates = customElts; customCandidates != NULL && !customCandidates->matches(id, term); customCandidates = customCandidates->nextSentence);
+
+  customSlotMask = 0;
+  if (customCandidates == NULL)
+    return;
+
+  for (TinyGPSCustom *p = customCandidates; p != customCandidates->nextSentence; p = p->next)
+  {
+    if (p->termNumber >= 0 && p->termNumber < _GPS_MAX_CUSTOM_TERMS && !(customSlotMask & (1UL << p->termNumber)))
+    {
+      customSlots[p->termNumber] = p;
+      customSlotMask |= 1UL << p->termNumber;
+    }
+  }
+}
+
+void TinyGPSPlus::setCustomCandidates()
+{
+  TinyGPSCustom *p, *end = customCandidates->nextSentence;
+
+  if (curTermNumber < _GPS_MAX_CUSTOM_TERMS)
+  {
+    if (!(customSlotMask & (1UL << curTermNumber)))
+      return;
+    p = customSlots[curTermNumber];
+  }
+  else
+  {
+    // Terms beyond the slot table are rare; find them the slow way
+    for (p = customCandidates; p != end && p->termNumber < curTermNumber; p = p->next);
+  }
+
+  for (; p != end && p->termNumber == curTermNumber; p = p->next)
+    p->set(term);
+}
+#endif
+
 /* static */
 double TinyGPSPlus::distanceBetween(double lat1, double long1, double lat2, double long2)
 {
@@ -349,24 +678,188 @@ const char *TinyGPSPlus::cardinal(double course)
   return directions[direction % 16];
 }
 
-void TinyGPSLocation::commit()
+// Integer trigonometry by CORDIC. Angles are binary angles, 2^32 to the
+// turn, so that they wrap around like the longitude; sines, cosines and
+// vector components are fixed point with 30 fraction bits.
+#define CORDIC_STEPS 30
+static const uint32_t cordicAtan[CORDIC_STEPS] = // atan(2^-i)
+{
+  536870912, 316933406, 167458907, 85004756, 42667331, 21354465, 10679838,
+  5340245, 2670163, 1335087, 667544, 333772, 166886, 83443, 41722, 20861,
+  10430, 5215, 2608, 1304, 652, 326, 163, 81, 41, 20, 10, 5, 3, 1
+};
+static const int32_t CORDIC_GAIN = 652032874; // 1 / the gain of the steps
+
+// Product of two fixed point numbers
+static int32_t fixedMul(int32_t a, int32_t b)
+{
+  return (int32_t)(((int64_t)a * b + (1L << 29)) >> 30);
+}
+
+// 1e-7 degrees to a binary angle
+static uint32_t binaryAngle(int32_t e7)
+{
+  // 2^62 / 3600000000
+  return (uint32_t)(((int64_t)e7 * 1281023894 + (1L << 29)) >> 30);
+}
+
+static void sinCos(uint32_t angle, int32_t &sine, int32_t &cosine)
+{
+  // The steps converge within +-99 degrees; the other half is mirrored
+  bool mirrored = angle - 0x40000000UL < 0x80000000UL;
+  int32_t z = (int32_t)(mirrored ? angle + 0x80000000UL : angle);
+  int32_t x = CORDIC_GAIN, y = 0;
+
+  // Each step turns towards z = 0; m is -1 to turn the other way, and
+  // (v ^ m) - m is v or -v without a branch
+  for (uint8_t i = 0; i < CORDIC_STEPS; ++i)
+  {
+    int32_t m = z >> 31;
+    int32_t dx = y >> i, dy = x >> i;
+    x -= (dx ^ m) - m;
+    y += (dy ^ m) - m;
+    z -= ((int32_t)cordicAtan[i] ^ m) - m;
+  }
+
+  sine = mirrored ? -y : y;
+  cosine = mirrored ? -x : x;
+}
+
+// Direction of the vector (x, y) as a binary angle, and its length.
+// The length must stay below 1.2 (in fixed point).
+static uint32_t vectorAngle(int32_t x, int32_t y, int32_t &length)
+{
+  uint32_t z = 0;
+  if (x < 0)
+  {
+    x = -x;
+    y = -y;
+    z = 0x80000000UL;
+  }
+
+  // Short vectors are scaled up, or the truncated shifts of the steps
+  // would add up to a large part of the length
+  uint8_t scale = 0;
+  while (((uint32_t)x | (uint32_t)(y < 0 ? -y : y)) < 0x10000000UL && (x | y) != 0)
+  {
+    x *= 2;
+    y *= 2;
+    ++scale;
+  }
+
+  // Each step turns towards y = 0
+  for (uint8_t i = 0; i < CORDIC_STEPS; ++i)
+  {
+    int32_t m = (y - 1) >> 31;
+    int32_t dx = y >> i, dy = x >> i;
+    x += (dx ^ m) - m;
+    y -= (dy ^ m) - m;
+    z += (uint32_t)(((int32_t)cordicAtan[i] ^ m) - m);
+  }
+
+  length = (int32_t)(((int64_t)x * CORDIC_GAIN + (1LL << (29 + scale))) >> (30 + scale));
+  return z;
+}
+
+/* static */
+uint32_t TinyGPSPlus::distanceBetweenE7(int32_t lat1, int32_t long1, int32_t lat2, int32_t long2)
+{
+  // distanceBetween() in integers; binary angles of the central angle
+  // are multiplied by the circumference
+  uint32_t a1 = binaryAngle(lat1), a2 = binaryAngle(lat2);
+  uint32_t dlong = binaryAngle(long2) - binaryAngle(long1);
+  int32_t length;
+
+  if ((uint32_t)(lat2 - lat1 + _GPS_FLAT_EARTH_LIMIT) <= 2 * _GPS_FLAT_EARTH_LIMIT
+      && binaryAngle(_GPS_FLAT_EARTH_LIMIT) + dlong <= 2 * binaryAngle(_GPS_FLAT_EARTH_LIMIT))
+  {
+    // Short distance: Pythagoras on the longitude scaled to the mean latitude
+    int32_t sine, cosine;
+    sinCos(a1 + (int32_t)(a2 - a1) / 2, sine, cosine);
+    vectorAngle((int32_t)(a2 - a1), fixedMul((int32_t)dlong, cosine), length);
+    return (uint32_t)(((uint64_t)length * _GPS_EARTH_CIRCUMFERENCE + 0x80000000UL) >> 32);
+  }
+
+  int32_t slat1, clat1, slat2, clat2, sdlong, cdlong;
+  sinCos(a1, slat1, clat1);
+  sinCos(a2, slat2, clat2);
+  sinCos(dlong, sdlong, cdlong);
+  int32_t clat2cdlong = fixedMul(clat2, cdlong);
+  vectorAngle(fixedMul(clat1, slat2) - fixedMul(slat1, clat2cdlong), fixedMul(clat2, sdlong), length);
+  int32_t denom = fixedMul(slat1, slat2) + fixedMul(clat1, clat2cdlong);
+  int32_t unused;
+  uint32_t angle = vectorAngle(denom, length, unused);
+  // 0 to 180 degrees, give or take the last step
+  if (angle > 0x80000000UL)
+    angle = angle >= 0xC0000000UL ? 0 : 0x80000000UL;
+  return (uint32_t)(((uint64_t)angle * _GPS_EARTH_CIRCUMFERENCE + 0x80000000UL) >> 32);
+}
+
+/* static */
+uint32_t TinyGPSPlus::courseToE7(int32_t lat1, int32_t long1, int32_t lat2, int32_t long2)
+{
+  // courseTo() in integers; 0 to 359.9999999 degrees
+  int32_t slat1, clat1, slat2, clat2, sdlong, cdlong;
+  sinCos(binaryAngle(lat1), slat1, clat1);
+  sinCos(binaryAngle(lat2), slat2, clat2);
+  sinCos(binaryAngle(long2) - binaryAngle(long1), sdlong, cdlong);
+  int32_t a1 = fixedMul(sdlong, clat2);
+  int32_t a2 = fixedMul(clat1, slat2) - fixedMul(fixedMul(slat1, clat2), cdlong);
+  if (a1 == 0 && a2 == 0)
+    return 0;
+
+  int32_t unused;
+  uint32_t course = (uint32_t)(((uint64_t)vectorAngle(a2, a1, unused) * 3600000000UL + 0x80000000UL) >> 32);
+  return course < 3600000000UL ? course : 0;
+}
+
+void TinyGPSLocation::commit(uint32_t now)
 {
    rawLatData = rawNewLatData;
    rawLngData = rawNewLngData;
    fixQuality = newFixQuality;
    fixMode = newFixMode;
-   lastCommitTime = millis();
+   lastCommitTime = now;
    valid = updated = true;
 }
 
-void TinyGPSLocation::setLatitude(const char *term)
+// Latitude up to 90 degrees; false, leaving the staged value, if out of range
+bool TinyGPSLocation::setLatitude(const char *term)
 {
-   TinyGPSPlus::parseDegrees(term, rawNewLatData);
+   RawDegrees deg;
+   if (!TinyGPSPlus::parseDegrees(term, deg) || deg.deg > 90 || (deg.deg == 90 && deg.billionths > 0))
+      return false;
+   rawNewLatData = deg;
+   return true;
 }
 
-void TinyGPSLocation::setLongitude(const char *term)
+// Longitude up to 180 degrees
+bool TinyGPSLocation::setLongitude(const char *term)
 {
-   TinyGPSPlus::parseDegrees(term, rawNewLngData);
+   RawDegrees deg;
+   if (!TinyGPSPlus::parseDegrees(term, deg) || (deg.deg == 180 && deg.billionths > 0))
+      return false;
+   rawNewLngData = deg;
+   return true;
+}
+
+// The raw value in 1e-7 degrees, rounded
+static int32_t rawDegreesE7(const RawDegrees &deg)
+{
+   int32_t ret = deg.deg * 10000000L + (deg.billionths + 50) / 100;
+   return deg.negative ? -ret : ret;
+}
+
+int32_t TinyGPSLocation::latE7()
+{
+   updated = false;
+   return rawDegreesE7(rawLatData);
+}
+
+int32_t TinyGPSLocation::lngE7()
+{
+   updated = false;
+   return rawDegreesE7(rawLngData);
 }
 
 double TinyGPSLocation::lat()
@@ -383,77 +876,177 @@ double TinyGPSLocation::lng()
    return rawLngData.negative ? -ret : ret;
 }
 
-void TinyGPSDate::commit()
+void TinyGPSDate::commit(uint32_t now)
 {
    date = newDate;
-   lastCommitTime = millis();
+   dayValue = date / 10000;
+   monthValue = (date / 100) % 100;
+   yearValue = date % 100 + 2000;
+   lastCommitTime = now;
    valid = updated = true;
 }
 
-void TinyGPSTime::commit()
+void TinyGPSTime::commit(uint32_t now)
 {
    time = newTime;
-   lastCommitTime = millis();
+   uint16_t hhmm = time / 10000;
+   uint16_t sscc = time % 10000;
+   hourValue = hhmm / 100;
+   minuteValue = hhmm % 100;
+   secondValue = sscc / 100;
+   centisecondValue = sscc % 100;
+   lastCommitTime = now;
    valid = updated = true;
 }
 
-void TinyGPSTime::setTime(const char *term)
+// Takes the date and time just committed as one record
+void TinyGPSPlus::commitDateTime(bool ubx)
 {
-   newTime = (uint32_t)TinyGPSPlus::parseDecimal(term);
+   dateTimeSnapshot.year = date.yearValue;
+   dateTimeSnapshot.month = date.monthValue;
+   dateTimeSnapshot.day = date.dayValue;
+   dateTimeSnapshot.hour = time.hourValue;
+   dateTimeSnapshot.minute = time.minuteValue;
+   dateTimeSnapshot.second = time.secondValue;
+   dateTimeSnapshot.centisecond = time.centisecondValue;
+   dateTimeSnapshot.commitTime = time.lastCommitTime;
+   dateTimeSnapshot.ubx = ubx;
+   ++dateTimeSnapshot.sequence;
 }
 
-void TinyGPSDate::setDate(const char *term)
+// hhmmss.cc; false, leaving the staged value, if not a time of day
+bool TinyGPSTime::setTime(const char *term)
 {
-   newDate = atol(term);
+   int32_t t = TinyGPSPlus::parseDecimal(term);
+   if (t < 0 || t / 1000000 >= 24 || t / 10000 % 100 >= 60 || t / 100 % 100 > 60)
+      return false;
+   newTime = (uint32_t)t;
+   return true;
 }
 
-uint16_t TinyGPSDate::year()
+// ddmmyy
+bool TinyGPSDate::setDate(const char *term)
 {
-   updated = false;
-   uint16_t year = date % 100;
-   return year + 2000;
+   uint32_t d = TinyGPSPlus::parseUnsigned(term);
+   uint32_t day = d / 10000, month = d / 100 % 100;
+   if (day < 1 || day > 31 || month < 1 || month > 12)
+      return false;
+   newDate = d;
+   return true;
 }
 
-uint8_t TinyGPSDate::month()
+// GSV: 1 = number of parts, 2 = part number, 3 = satellites in view,
+// then PRN, elevation, azimuth and SNR for up to four satellites
+void TinyGPSSatellites::setTerm(uint8_t termNumber, const char *term)
 {
-   updated = false;
-   return (date / 100) % 100;
+   switch(termNumber)
+   {
+   case 1:
+      newParts = (uint8_t)TinyGPSPlus::parseUnsigned(term);
+      break;
+   case 2:
+      newPart = (uint8_t)TinyGPSPlus::parseUnsigned(term);
+      if (newPart == 1)
+      {
+         stagedCount = 0;
+         stagedConstellation = newConstellation;
+         nextPart = 1;
+      }
+      break;
+   case 3:
+      {
+         // Satellites described by this part; clear their staging slots
+         // so that empty fields read as 0
+         uint8_t inView = (uint8_t)TinyGPSPlus::parseUnsigned(term);
+         uint8_t before = 4 * (newPart - 1);
+         newPartSats = inView > before ? inView - before : 0;
+         if (newPartSats > 4)
+            newPartSats = 4;
+         if (newPartSats > _GPS_MAX_SATELLITES - stagedCount)
+            newPartSats = _GPS_MAX_SATELLITES - stagedCount;
+         for (uint8_t i = stagedCount; i < stagedCount + newPartSats; ++i)
+         {
+            stagedPrns[i] = stagedElevations[i] = stagedSnrs[i] = 0;
+            stagedAzimuths[i] = 0;
+         }
+      }
+      break;
+   default:
+      if (termNumber >= 4 && term[0])
+      {
+         uint8_t sat = (termNumber - 4) / 4;
+         if (sat >= newPartSats)
+            break;
+         uint8_t i = stagedCount + sat;
+         switch((termNumber - 4) % 4)
+         {
+         case 0: stagedPrns[i] = (uint8_t)TinyGPSPlus::parseUnsigned(term); break;
+         case 1: stagedElevations[i] = (uint8_t)TinyGPSPlus::parseUnsigned(term); break;
+         case 2: stagedAzimuths[i] = (uint16_t)TinyGPSPlus::parseUnsigned(term); break;
+         case 3: stagedSnrs[i] = (uint8_t)TinyGPSPlus::parseUnsigned(term); break;
+         }
+      }
+      break;
+   }
 }
 
-uint8_t TinyGPSDate::day()
+// Called for every GSV part that passed the checksum test
+void TinyGPSSatellites::commit(uint32_t now)
 {
-   updated = false;
-   return date / 10000;
-}
+   if (newPart == 0 || newPart != nextPart || newConstellation != stagedConstellation)
+   {
+      // Part out of sequence; drop the sequence until the next first part
+      nextPart = 0;
+      return;
+   }
 
-uint8_t TinyGPSTime::hour()
-{
-   updated = false;
-   return time / 1000000;
-}
+   stagedCount += newPartSats;
+   ++nextPart;
+   if (newPart != newParts)
+      return;
 
-uint8_t TinyGPSTime::minute()
-{
-   updated = false;
-   return (time / 10000) % 100;
-}
+   // Last part: replace this constellation's satellites in the table
+   uint8_t n = 0;
+   for (uint8_t i = 0; i < satCount; ++i)
+   {
+      if (constellations[i] == stagedConstellation)
+         continue;
+      prns[n] = prns[i];
+      elevations[n] = elevations[i];
+      azimuths[n] = azimuths[i];
+      snrs[n] = snrs[i];
+      constellations[n] = constellations[i];
+      ++n;
+   }
 
-uint8_t TinyGPSTime::second()
-{
-   updated = false;
-   return (time / 100) % 100;
+   for (uint8_t i = 0; i < stagedCount && n < _GPS_MAX_SATELLITES; ++i, ++n)
+   {
+      prns[n] = stagedPrns[i];
+      elevations[n] = stagedElevations[i];
+      azimuths[n] = stagedAzimuths[i];
+      snrs[n] = stagedSnrs[i];
+      constellations[n] = stagedConstellation;
+   }
+
+   satCount = n;
+   nextPart = 0;
+   lastCommitTime = now;
+   valid = updated = true;
 }
 
-uint8_t TinyGPSTime::centisecond()
+uint8_t TinyGPSSatellites::count(Constellation c) const
 {
-   updated = false;
-   return time % 100;
+   uint8_t n = 0;
+   for (uint8_t i = 0; i < satCount; ++i)
+      if (constellations[i] == c)
+         ++n;
+   return n;
 }
 
-void TinyGPSDecimal::commit()
+void TinyGPSDecimal::commit(uint32_t now)
 {
    val = newval;
-   lastCommitTime = millis();
+   lastCommitTime = now;
    valid = updated = true;
 }
 
@@ -462,18 +1055,19 @@ void TinyGPSDecimal::set(const char *term)
    newval = TinyGPSPlus::parseDecimal(term);
 }
 
-void TinyGPSInteger::commit()
+void TinyGPSInteger::commit(uint32_t now)
 {
    val = newval;
-   lastCommitTime = millis();
+   lastCommitTime = now;
    valid = updated = true;
 }
 
 void TinyGPSInteger::set(const char *term)
 {
-   newval = atol(term);
+   newval = TinyGPSPlus::parseUnsigned(term);
 }
 
+#if _GPS_HAS(_GPS_FEATURE_CUSTOM)
 TinyGPSCustom::TinyGPSCustom(TinyGPSPlus &gps, const char *_sentenceName, int _termNumber)
 {
    begin(gps, _sentenceName, _termNumber);
@@ -484,6 +1078,7 @@ void TinyGPSCustom::begin(TinyGPSPlus &gps, const char *_sentenceName, int _term
    lastCommitTime = 0;
    updated = valid = false;
    sentenceName = _sentenceName;
+   sentenceId = TinyGPSPlus::sentenceId(_sentenceName);
    termNumber = _termNumber;
    memset(stagingBuffer, '\0', sizeof(stagingBuffer));
    memset(buffer, '\0', sizeof(buffer));
@@ -492,10 +1087,16 @@ void TinyGPSCustom::begin(TinyGPSPlus &gps, const char *_sentenceName, int _term
    gps.insertCustom(this, _sentenceName, _termNumber);
 }
 
-void TinyGPSCustom::commit()
+// Names that pack into a sentence ID compare as integers, the rest with strcmp
+bool TinyGPSCustom::matches(uint32_t id, const char *name) const
+{
+   return id != 0 || sentenceId != 0 ? id == sentenceId : strcmp(name, sentenceName) == 0;
+}
+
+void TinyGPSCustom::commit(uint32_t now)
 {
    strcpy(this->buffer, this->stagingBuffer);
-   lastCommitTime = millis();
+   lastCommitTime = now;
    valid = updated = true;
 }
 
@@ -517,4 +1118,16 @@ void TinyGPSPlus::insertCustom(TinyGPSCustom *pElt, const char *sentenceName, in
 
    pElt->next = *ppelt;
    *ppelt = pElt;
+
+   // Rebuild the links between sentence groups
+   for (TinyGPSCustom *group = this->customElts; group != NULL; )
+   {
+      TinyGPSCustom *end = group->next;
+      while (end != NULL && end->matches(group->sentenceId, group->sentenceName))
+         end = end->next;
+      for (TinyGPSCustom *p = group; p != end; p = p->next)
+         p->nextSentence = end;
+      group = end;
+   }
 }
+#endif
@@ -27,7 +27,20 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 #define __TinyGPSPlus_h
 
 #include <inttypes.h>
+#if defined(ARDUINO) || defined(__AVR__)
 #include "Arduino.h"
+#else
+// Minimal subset of the Arduino API used by the library, for host builds
+#include <stddef.h>
+#include <math.h>
+typedef uint8_t byte;
+unsigned long millis();
+unsigned long micros();
+#define TWO_PI 6.283185307179586476925286766559
+#define radians(deg) ((deg)*0.017453292519943295769236907684886)
+#define degrees(rad) ((rad)*57.295779513082320876798154814105)
+#define sq(x) ((x)*(x))
+#endif
 #include <limits.h>
 
 #define _GPS_VERSION "1.1.0" // software version of this library
@@ -38,7 +51,33 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 #define _GPS_KM_PER_METER 0.001
 #define _GPS_FEET_PER_METER 3.2808399
 #define _GPS_MAX_FIELD_SIZE 15
+#define _GPS_MAX_SENTENCE_ID_LEN 5
+#define _GPS_MAX_CUSTOM_TERMS 32 // terms with an indexed custom slot (width of the slot mask)
+#ifndef _GPS_MAX_SATELLITES
+#define _GPS_MAX_SATELLITES 32 // capacity of the GSV satellite table
+#endif
 #define _GPS_EARTH_MEAN_RADIUS 6371009 // old: 6372795
+#define _GPS_EARTH_CIRCUMFERENCE 40030230 // metres, 2 * pi * _GPS_EARTH_MEAN_RADIUS
+#define _GPS_FLAT_EARTH_LIMIT 2500000 // 1e-7 degrees, see distanceBetweenE7()
+
+// Compile-time feature selection. Date and time are always parsed; the
+// other fields, their term handlers and their RAM can be left out by
+// defining _GPS_FEATURES, e.g. -D _GPS_FEATURES=_GPS_FEATURES_TIME
+#define _GPS_FEATURE_LOCATION   0x0001 // location
+#define _GPS_FEATURE_SPEED      0x0002 // speed
+#define _GPS_FEATURE_COURSE     0x0004 // course
+#define _GPS_FEATURE_ALTITUDE   0x0008 // altitude
+#define _GPS_FEATURE_SATELLITES 0x0010 // satellites (number used in the fix)
+#define _GPS_FEATURE_HDOP       0x0020 // hdop
+#define _GPS_FEATURE_GSV        0x0040 // satellitesInView table
+#define _GPS_FEATURE_CUSTOM     0x0080 // TinyGPSCustom
+#define _GPS_FEATURE_STATS      0x0100 // charsProcessed(), passedChecksum(), ...
+#define _GPS_FEATURES_TIME      0x0000
+#define _GPS_FEATURES_ALL       0x01FF
+#ifndef _GPS_FEATURES
+#define _GPS_FEATURES _GPS_FEATURES_ALL
+#endif
+#define _GPS_HAS(feature) ((_GPS_FEATURES & (feature)) != 0)
 
 struct RawDegrees
 {
@@ -53,9 +92,11 @@ public:
 struct TinyGPSLocation
 {
    friend class TinyGPSPlus;
+   friend class TinyGPSUbx;
 public:
-   enum Quality { Invalid = '0', GPS = '1', DGPS = '2', PPS = '3', RTK = '4', FloatRTK = '5', Estimated = '6', Manual = '7', Simulated = '8' };
-   enum Mode { N = 'N', A = 'A', D = 'D', E = 'E'};
+   // Any character of the sentence is a valid value
+   enum Quality : char { Invalid = '0', GPS = '1', DGPS = '2', PPS = '3', RTK = '4', FloatRTK = '5', Estimated = '6', Manual = '7', Simulated = '8' };
+   enum Mode : char { N = 'N', A = 'A', D = 'D', E = 'E'};
 
    bool isValid() const    { return valid; }
    bool isUpdated() const  { return updated; }
@@ -64,10 +105,12 @@ public:
    const RawDegrees &rawLng()     { updated = false; return rawLngData; }
    double lat();
    double lng();
+   int32_t latE7();               // 1e-7 degrees, without floating point
+   int32_t lngE7();
    Quality FixQuality()           { updated = false; return fixQuality; }
    Mode FixMode()                 { updated = false; return fixMode; }
 
-   TinyGPSLocation() : valid(false), updated(false), fixQuality(Invalid), fixMode(N)
+   TinyGPSLocation() : valid(false), updated(false), fixQuality(Invalid), newFixQuality(Invalid), fixMode(N), newFixMode(N)
    {}
 
 private:
@@ -76,97 +119,119 @@ private:
    Quality fixQuality, newFixQuality;
    Mode fixMode, newFixMode;
    uint32_t lastCommitTime;
-   void commit();
-   void setLatitude(const char *term);
-   void setLongitude(const char *term);
+   void commit(uint32_t now);
+   bool setLatitude(const char *term);
+   bool setLongitude(const char *term);
 };
 
 struct TinyGPSDate
 {
    friend class TinyGPSPlus;
+   friend class TinyGPSUbx;
 public:
    bool isValid() const       { return valid; }
    bool isUpdated() const     { return updated; }
    uint32_t age() const       { return valid ? millis() - lastCommitTime : (uint32_t)ULONG_MAX; }
 
    uint32_t value()           { updated = false; return date; }
-   uint16_t year();
-   uint8_t month();
-   uint8_t day();
+   uint16_t year()            { updated = false; return yearValue; }
+   uint8_t month()            { updated = false; return monthValue; }
+   uint8_t day()              { updated = false; return dayValue; }
 
-   TinyGPSDate() : valid(false), updated(false), date(0)
+   TinyGPSDate() : valid(false), updated(false), date(0), newDate(0), yearValue(2000), monthValue(0), dayValue(0)
    {}
 
 private:
    bool valid, updated;
    uint32_t date, newDate;
+   // date broken down once at commit, not on every read
+   uint16_t yearValue;
+   uint8_t monthValue, dayValue;
    uint32_t lastCommitTime;
-   void commit();
-   void setDate(const char *term);
+   void commit(uint32_t now);
+   bool setDate(const char *term);
 };
 
 struct TinyGPSTime
 {
    friend class TinyGPSPlus;
+   friend class TinyGPSUbx;
 public:
    bool isValid() const       { return valid; }
    bool isUpdated() const     { return updated; }
    uint32_t age() const       { return valid ? millis() - lastCommitTime : (uint32_t)ULONG_MAX; }
 
    uint32_t value()           { updated = false; return time; }
-   uint8_t hour();
-   uint8_t minute();
-   uint8_t second();
-   uint8_t centisecond();
+   uint8_t hour()             { updated = false; return hourValue; }
+   uint8_t minute()           { updated = false; return minuteValue; }
+   uint8_t second()           { updated = false; return secondValue; }
+   uint8_t centisecond()      { updated = false; return centisecondValue; }
 
-   TinyGPSTime() : valid(false), updated(false), time(0)
+   TinyGPSTime() : valid(false), updated(false), time(0), newTime(0), hourValue(0), minuteValue(0), secondValue(0), centisecondValue(0)
    {}
 
 private:
    bool valid, updated;
    uint32_t time, newTime;
+   // time broken down once at commit, not on every read
+   uint8_t hourValue, minuteValue, secondValue, centisecondValue;
    uint32_t lastCommitTime;
-   void commit();
-   void setTime(const char *term);
+   void commit(uint32_t now);
+   bool setTime(const char *term);
+};
+
+// Date and time committed together by one RMC, ZDA or UBX message.
+// Copied out in one piece, so the fields never come from two sentences;
+// a sequence number that differs from the last copy means a new commit.
+struct TinyGPSDateTime
+{
+   uint16_t year;
+   uint8_t month, day;
+   uint8_t hour, minute, second, centisecond;
+   uint32_t sequence;    // number of the commit, 0 before the first
+   uint32_t commitTime;  // millis() at the commit
+   bool ubx;             // from a UBX message, not an NMEA sentence
 };
 
 struct TinyGPSDecimal
 {
    friend class TinyGPSPlus;
+   friend class TinyGPSUbx;
 public:
    bool isValid() const    { return valid; }
    bool isUpdated() const  { return updated; }
    uint32_t age() const    { return valid ? millis() - lastCommitTime : (uint32_t)ULONG_MAX; }
    int32_t value()         { updated = false; return val; }
 
-   TinyGPSDecimal() : valid(false), updated(false), val(0)
+   TinyGPSDecimal() : valid(false), updated(false), val(0), newval(0)
    {}
 
 private:
    bool valid, updated;
    uint32_t lastCommitTime;
    int32_t val, newval;
-   void commit();
+   void commit(uint32_t now);
    void set(const char *term);
 };
 
 struct TinyGPSInteger
 {
    friend class TinyGPSPlus;
+   friend class TinyGPSUbx;
 public:
    bool isValid() const    { return valid; }
    bool isUpdated() const  { return updated; }
    uint32_t age() const    { return valid ? millis() - lastCommitTime : (uint32_t)ULONG_MAX; }
    uint32_t value()        { updated = false; return val; }
 
-   TinyGPSInteger() : valid(false), updated(false), val(0)
+   TinyGPSInteger() : valid(false), updated(false), val(0), newval(0)
    {}
 
 private:
    bool valid, updated;
    uint32_t lastCommitTime;
    uint32_t val, newval;
-   void commit();
+   void commit(uint32_t now);
    void set(const char *term);
 };
 
@@ -196,7 +261,60 @@ struct TinyGPSHDOP : TinyGPSDecimal
    double hdop() { return value() / 100.0; }
 };
 
+// Satellites in view from GSV sentences, kept in a fixed-size struct-of-arrays
+// table. A multi-part GSV sequence is collected in a staging table and
+// committed for its constellation only when the last part has arrived.
+struct TinyGPSSatellites
+{
+   friend class TinyGPSPlus;
+public:
+   enum Constellation { GPS = 'P', GLONASS = 'L', Galileo = 'A', BeiDou = 'B', GNSS = 'N' };
+
+   bool isValid() const       { return valid; }
+   bool isUpdated() const     { return updated; }
+   uint32_t age() const       { return valid ? millis() - lastCommitTime : (uint32_t)ULONG_MAX; }
+
+   uint8_t count()            { updated = false; return satCount; }
+   uint8_t count(Constellation c) const;
+   uint8_t prn(uint8_t i) const                  { return prns[i]; }
+   uint8_t elevation(uint8_t i) const            { return elevations[i]; }
+   uint16_t azimuth(uint8_t i) const             { return azimuths[i]; }
+   uint8_t snr(uint8_t i) const                  { return snrs[i]; } // 0 when not tracking
+   Constellation constellation(uint8_t i) const  { return (Constellation)constellations[i]; }
+
+   TinyGPSSatellites() : valid(false), updated(false), satCount(0), stagedCount(0), nextPart(0)
+   {}
+
+private:
+   bool valid, updated;
+   uint32_t lastCommitTime;
+
+   // committed table
+   uint8_t satCount;
+   uint8_t prns[_GPS_MAX_SATELLITES];
+   uint8_t elevations[_GPS_MAX_SATELLITES];
+   uint16_t azimuths[_GPS_MAX_SATELLITES];
+   uint8_t snrs[_GPS_MAX_SATELLITES];
+   char constellations[_GPS_MAX_SATELLITES];
+
+   // sequence being received
+   uint8_t stagedCount, nextPart;
+   char stagedConstellation;
+   uint8_t stagedPrns[_GPS_MAX_SATELLITES];
+   uint8_t stagedElevations[_GPS_MAX_SATELLITES];
+   uint16_t stagedAzimuths[_GPS_MAX_SATELLITES];
+   uint8_t stagedSnrs[_GPS_MAX_SATELLITES];
+
+   // sentence being received
+   char newConstellation;
+   uint8_t newParts, newPart, newPartSats;
+
+   void commit(uint32_t now);
+   void setTerm(uint8_t termNumber, const char *term);
+};
+
 class TinyGPSPlus;
+#if _GPS_HAS(_GPS_FEATURE_CUSTOM)
 class TinyGPSCustom
 {
 public:
@@ -210,7 +328,7 @@ public:
    const char *value()     { updated = false; return buffer; }
 
 private:
-   void commit();
+   void commit(uint32_t now);
    void set(const char *term);
 
    char stagingBuffer[_GPS_MAX_FIELD_SIZE + 1];
@@ -218,26 +336,52 @@ private:
    unsigned long lastCommitTime;
    bool valid, updated;
    const char *sentenceName;
+   uint32_t sentenceId;
    int termNumber;
+   bool matches(uint32_t id, const char *name) const;
    friend class TinyGPSPlus;
    TinyGPSCustom *next;
+   TinyGPSCustom *nextSentence; // first element of the next sentence group
 };
+#endif
 
 class TinyGPSPlus
 {
 public:
+  enum {GPS_SENTENCE_GGA, GPS_SENTENCE_RMC, GPS_SENTENCE_GSV, GPS_SENTENCE_GSA,
+        GPS_SENTENCE_VTG, GPS_SENTENCE_ZDA, GPS_SENTENCE_GLL, GPS_SENTENCE_TXT,
+        GPS_SENTENCE_OTHER, GPS_SENTENCE_TYPES};
+
   TinyGPSPlus();
   bool encode(char c); // process one character received from GPS
+  size_t encode(const char *buf, size_t len); // process a block of characters, returns # of valid sentences
   TinyGPSPlus &operator << (char c) {encode(c); return *this;}
 
-  TinyGPSLocation location;
   TinyGPSDate date;
   TinyGPSTime time;
+#if _GPS_HAS(_GPS_FEATURE_LOCATION)
+  TinyGPSLocation location;
+#endif
+#if _GPS_HAS(_GPS_FEATURE_SPEED)
   TinyGPSSpeed speed;
+#endif
+#if _GPS_HAS(_GPS_FEATURE_COURSE)
   TinyGPSCourse course;
+#endif
+#if _GPS_HAS(_GPS_FEATURE_ALTITUDE)
   TinyGPSAltitude altitude;
+#endif
+#if _GPS_HAS(_GPS_FEATURE_SATELLITES)
   TinyGPSInteger satellites;
+#endif
+#if _GPS_HAS(_GPS_FEATURE_HDOP)
   TinyGPSHDOP hdop;
+#endif
+#if _GPS_HAS(_GPS_FEATURE_GSV)
+  TinyGPSSatellites satellitesInView;
+#endif
+
+  const TinyGPSDateTime &dateTime() const { return dateTimeSnapshot; }
 
   static const char *libraryVersion() { return _GPS_VERSION; }
 
@@ -245,40 +389,93 @@ public:
   static double courseTo(double lat1, double long1, double lat2, double long2);
   static const char *cardinal(double course);
 
+  // Integer versions of the above for CPUs without an FPU: coordinates
+  // and course in 1e-7 degrees (as latE7() and lngE7()), distance in
+  // metres. Points closer than _GPS_FLAT_EARTH_LIMIT in latitude and
+  // longitude are measured on a flat-earth approximation. Compared with
+  // the double versions (tools/geo_bench), the distance is within 1 m
+  // and the course moves the destination less than 0.25 m sideways.
+  static uint32_t distanceBetweenE7(int32_t lat1, int32_t long1, int32_t lat2, int32_t long2);
+  static uint32_t courseToE7(int32_t lat1, int32_t long1, int32_t lat2, int32_t long2);
+
+  // Sentence names ("GPRMC", "PUBX", ...) of up to 5 characters [0-9A-Z]
+  // packed into an integer, 6 bits per character; 0 if the name can't be packed.
+  // Usable in constant expressions, e.g. as a case label.
+  static constexpr uint32_t sentenceId(const char *name, uint8_t len = 0, uint32_t id = 0)
+  {
+    return *name == '\0' ? id
+         : len == _GPS_MAX_SENTENCE_ID_LEN || sentenceIdCode(*name) == 0 ? 0
+         : sentenceId(name + 1, len + 1, (id << 6) | sentenceIdCode(*name));
+  }
+
+  static uint32_t parseUnsigned(const char *term);
   static int32_t parseDecimal(const char *term);
-  static void parseDegrees(const char *term, RawDegrees &deg);
+  static bool parseDegrees(const char *term, RawDegrees &deg);
 
+#if _GPS_HAS(_GPS_FEATURE_STATS)
   uint32_t charsProcessed()   const { return encodedCharCount; }
   uint32_t sentencesWithFix() const { return sentencesWithFixCount; }
-  uint32_t failedChecksum()   const { return failedChecksumCount; }
+  uint32_t failedChecksum()   const { return failedChecksumCount; } // and malformed sentences
   uint32_t passedChecksum()   const { return passedChecksumCount; }
+  // Sentences that passed the checksum test, by GPS_SENTENCE_* type
+  uint32_t sentenceCount(uint8_t type) const { return type < GPS_SENTENCE_TYPES ? sentenceCounts[type] : 0; }
+  static const char *sentenceTypeName(uint8_t type);
+  // Microseconds from the '$' to the checksum of the last valid sentence
+  uint32_t sentenceTime()     const { return lastSentenceTime; }
+#endif
 
 private:
-  enum {GPS_SENTENCE_GGA, GPS_SENTENCE_RMC, GPS_SENTENCE_OTHER};
+  static constexpr uint32_t sentenceIdCode(char c)
+  {
+    return c >= '0' && c <= '9' ? c - '0' + 1
+         : c >= 'A' && c <= 'Z' ? c - 'A' + 11
+         : 0;
+  }
 
   // parsing state variables
   uint8_t parity;
   bool isChecksumTerm;
+  bool inSentence; // from '$' to the checksum, unless rejected on the way
   char term[_GPS_MAX_FIELD_SIZE];
   uint8_t curSentenceType;
   uint8_t curTermNumber;
   uint8_t curTermOffset;
   bool sentenceHasFix;
+  bool sentenceHasTime; // time and date fields of this sentence, not empty
+  bool sentenceHasDate;
+
+  // date and time of the last commit of both
+  friend class TinyGPSUbx;
+  TinyGPSDateTime dateTimeSnapshot;
+  void commitDateTime(bool ubx);
 
+#if _GPS_HAS(_GPS_FEATURE_CUSTOM)
   // custom element support
   friend class TinyGPSCustom;
   TinyGPSCustom *customElts;
   TinyGPSCustom *customCandidates;
+  TinyGPSCustom *customSlots[_GPS_MAX_CUSTOM_TERMS]; // first candidate per term of the current sentence
+  uint32_t customSlotMask;                           // which customSlots are set
   void insertCustom(TinyGPSCustom *pElt, const char *sentenceName, int index);
+  void selectCustomCandidates(uint32_t id);
+  void setCustomCandidates();
+#endif
 
+#if _GPS_HAS(_GPS_FEATURE_STATS)
   // statistics
   uint32_t encodedCharCount;
   uint32_t sentencesWithFixCount;
   uint32_t failedChecksumCount;
   uint32_t passedChecksumCount;
+  uint32_t sentenceCounts[GPS_SENTENCE_TYPES];
+  uint32_t sentenceStartTime;
+  uint32_t lastSentenceTime;
+#endif
 
   // internal utilities
   int fromHex(char a);
+  void rejectSentence();
+  uint8_t sentenceType(uint32_t id);
   bool endOfTermHandler();
 };
 
@@ -0,0 +1,386 @@
+/*
+TinyGPSUbx - u-blox UBX protocol support for TinyGPSPlus
+Copyright (C) 2026 Tauno Erik
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "TinyGPSUbx.h"
+
+#include <string.h>
+
+TinyGPSUbx::TinyGPSUbx(TinyGPSPlus &_gps)
+  :  gps(_gps)
+  ,  state(UBX_SYNC_1)
+  ,  ack(AckNone)
+  ,  ackClass(0)
+  ,  ackId(0)
+  ,  ackCount(0)
+  ,  frameCount(0)
+  ,  failedChecksumCount(0)
+{
+}
+
+//
+// public methods
+//
+
+bool TinyGPSUbx::encode(char c)
+{
+  uint8_t b = (uint8_t)c;
+
+  // The checksum covers class, id, length and payload
+  if (state >= UBX_CLASS && state <= UBX_PAYLOAD)
+  {
+    ckA += b;
+    ckB += ckA;
+  }
+
+  switch(state)
+  {
+  case UBX_SYNC_1:
+    if (b == _GPS_UBX_SYNC_1)
+      state = UBX_SYNC_2;
+    else
+      gps.encode(c);
+    return false;
+
+  case UBX_SYNC_2:
+    if (b == _GPS_UBX_SYNC_2)
+    {
+      state = UBX_CLASS;
+      ckA = ckB = 0;
+    }
+    else
+    {
+      state = UBX_SYNC_1;
+      gps.encode(c);
+    }
+    return false;
+
+  case UBX_CLASS:
+    msgClass = b;
+    state = UBX_ID;
+    return false;
+
+  case UBX_ID:
+    msgId = b;
+    state = UBX_LENGTH_1;
+    return false;
+
+  case UBX_LENGTH_1:
+    length = b;
+    state = UBX_LENGTH_2;
+    return false;
+
+  case UBX_LENGTH_2:
+    length |= (uint16_t)b << 8;
+    offset = 0;
+    // Garbage (e.g. around a baud rate change) must not swallow
+    // kilobytes of NMEA while waiting for the end of a bogus frame
+    if (length > _GPS_UBX_MAX_LENGTH)
+      state = UBX_SYNC_1;
+    else
+      state = length > 0 ? UBX_PAYLOAD : UBX_CK_A;
+    return false;
+
+  case UBX_PAYLOAD:
+    // Payloads that don't fit are checksummed but not stored
+    if (offset < sizeof(payload))
+      payload[offset] = b;
+    if (++offset == length)
+      state = UBX_CK_A;
+    return false;
+
+  case UBX_CK_A:
+    state = b == ckA ? UBX_CK_B : UBX_SYNC_1;
+    if (state == UBX_SYNC_1)
+      ++failedChecksumCount;
+    return false;
+
+  case UBX_CK_B:
+    state = UBX_SYNC_1;
+    if (b != ckB)
+    {
+      ++failedChecksumCount;
+      return false;
+    }
+    if (length > sizeof(payload))
+      return false;
+    ++frameCount;
+    frameHandler();
+    return true;
+  }
+
+  return false;
+}
+
+// Block-oriented variant: runs of NMEA text between UBX frames go to
+// TinyGPSPlus::encode(buf, len) in one call
+size_t TinyGPSUbx::encode(const char *buf, size_t len)
+{
+  const char *end = buf + len;
+  size_t valid = 0;
+
+  while (buf < end)
+  {
+    if (state == UBX_SYNC_1)
+    {
+      const char *sync = (const char *)memchr(buf, _GPS_UBX_SYNC_1, end - buf);
+      if (sync == NULL)
+        sync = end;
+      valid += gps.encode(buf, sync - buf);
+      buf = sync;
+      if (buf == end)
+        break;
+    }
+
+    // Payload bytes in one tight loop
+    if (state == UBX_PAYLOAD)
+    {
+      size_t run = length - offset;
+      if (run > (size_t)(end - buf))
+        run = end - buf;
+      for (const char *runEnd = buf + run; buf < runEnd; ++buf)
+      {
+        uint8_t b = (uint8_t)*buf;
+        ckA += b;
+        ckB += ckA;
+        if (offset < sizeof(payload))
+          payload[offset] = b;
+        ++offset;
+      }
+      if (offset == length)
+        state = UBX_CK_A;
+      continue;
+    }
+
+    // A lone first sync byte; what follows goes back to NMEA and may
+    // end a sentence, which encode(char) doesn't report
+    if (state == UBX_SYNC_2 && (uint8_t)*buf != _GPS_UBX_SYNC_2)
+    {
+      state = UBX_SYNC_1;
+      valid += gps.encode(buf++, 1);
+      continue;
+    }
+
+    if (encode(*buf++))
+      ++valid;
+  }
+
+  return valid;
+}
+
+// static
+// 8-bit Fletcher checksum over class, id, length and payload
+void TinyGPSUbx::checksum(const uint8_t *data, size_t len, uint8_t &ckA, uint8_t &ckB)
+{
+  ckA = ckB = 0;
+  for (size_t i = 0; i < len; ++i)
+  {
+    ckA += data[i];
+    ckB += ckA;
+  }
+}
+
+// static
+// Build a complete frame; frame must have room for len + _GPS_UBX_FRAME_OVERHEAD bytes
+size_t TinyGPSUbx::buildFrame(uint8_t msgClass, uint8_t msgId, const uint8_t *payload, uint16_t len, uint8_t *frame)
+{
+  frame[0] = _GPS_UBX_SYNC_1;
+  frame[1] = _GPS_UBX_SYNC_2;
+  frame[2] = msgClass;
+  frame[3] = msgId;
+  frame[4] = len & 0xFF;
+  frame[5] = len >> 8;
+  if (len > 0)
+    memcpy(frame + 6, payload, len);
+  checksum(frame + 2, len + 4, frame[len + 6], frame[len + 7]);
+  return len + _GPS_UBX_FRAME_OVERHEAD;
+}
+
+//
+// internal utilities
+//
+
+// Processes a frame that just passed the checksum test
+void TinyGPSUbx::frameHandler()
+{
+  if (msgClass == UBX_CLASS_ACK && length == 2 && (msgId == UBX_ACK_ACK || msgId == UBX_ACK_NAK))
+  {
+    ack = msgId == UBX_ACK_ACK ? AckAck : AckNak;
+    ackClass = payload[0];
+    ackId = payload[1];
+    ++ackCount;
+  }
+  else if (msgClass == UBX_CLASS_NAV && msgId == UBX_NAV_TIMEUTC && length == sizeof(TinyGPSUbxNavTimeUtc))
+  {
+    const TinyGPSUbxNavTimeUtc &t = navTimeUtc;
+    if (t.valid & UBX_TIMEUTC_VALID_UTC)
+      setDateTime(t.year, t.month, t.day, t.hour, t.min, t.sec, t.nano, true, true);
+  }
+  else if (msgClass == UBX_CLASS_NAV && msgId == UBX_NAV_PVT && length >= UBX_NAV_PVT_MIN_LENGTH)
+  {
+    setNavPvt();
+  }
+}
+
+// Same encoding as the RMC fields: DDMMYY and HHMMSSCC
+void TinyGPSUbx::setDateTime(uint16_t year, uint8_t month, uint8_t day, uint8_t hour, uint8_t min, uint8_t sec, int32_t nano, bool date, bool time)
+{
+  uint32_t now = millis();
+
+  if (date)
+  {
+    gps.date.newDate = day * 10000UL + month * 100UL + year % 100;
+    gps.date.commit(now);
+  }
+
+  if (time)
+  {
+    // A negative fraction belongs to the rounded-up second before it
+    uint8_t centisecond = nano > 0 ? nano / 10000000L : 0;
+    gps.time.newTime = hour * 1000000UL + min * 10000UL + sec * 100UL + centisecond;
+    gps.time.commit(now);
+  }
+
+  if (date && time)
+    gps.commitDateTime(true);
+}
+
+#if _GPS_HAS(_GPS_FEATURE_LOCATION)
+static void setRawDegrees(int32_t value, RawDegrees &deg)
+{
+  // 1e-7 degrees
+  deg.negative = value < 0;
+  uint32_t magnitude = deg.negative ? -(uint32_t)value : (uint32_t)value;
+  deg.deg = magnitude / 10000000UL;
+  deg.billionths = (magnitude % 10000000UL) * 100;
+}
+#endif
+
+void TinyGPSUbx::setNavPvt()
+{
+  const TinyGPSUbxNavPvt &p = navPvt;
+
+  setDateTime(p.year, p.month, p.day, p.hour, p.min, p.sec, p.nano,
+    p.valid & UBX_PVT_VALID_DATE, p.valid & UBX_PVT_VALID_TIME);
+
+#if _GPS_HAS(_GPS_FEATURE_SATELLITES)
+  gps.satellites.newval = p.numSV;
+  gps.satellites.commit(millis());
+#endif
+
+  if (!(p.flags & UBX_PVT_FLAGS_FIX_OK) || p.fixType < 2 || p.fixType > 4)
+    return;
+
+  // Units of the NMEA fields: cm, 1/100 knot and 1/100 degree
+#if _GPS_HAS(_GPS_FEATURE_LOCATION)
+  setRawDegrees(p.lat, gps.location.rawNewLatData);
+  setRawDegrees(p.lon, gps.location.rawNewLngData);
+  gps.location.newFixQuality = p.flags & UBX_PVT_FLAGS_DIFF ? TinyGPSLocation::DGPS : TinyGPSLocation::GPS;
+  gps.location.newFixMode = p.flags & UBX_PVT_FLAGS_DIFF ? TinyGPSLocation::D : TinyGPSLocation::A;
+  gps.location.commit(millis());
+#endif
+#if _GPS_HAS(_GPS_FEATURE_ALTITUDE)
+  gps.altitude.newval = p.hMSL / 10;
+  gps.altitude.commit(millis());
+#endif
+#if _GPS_HAS(_GPS_FEATURE_SPEED)
+  gps.speed.newval = (int32_t)((int64_t)p.gSpeed * 360 / 1852);
+  gps.speed.commit(millis());
+#endif
+#if _GPS_HAS(_GPS_FEATURE_COURSE)
+  gps.course.newval = p.headMot / 1000;
+  gps.course.commit(millis());
+#endif
+}
+
+void TinyGPSUbxConfig::begin(TinyGPSUbx &_ubx, WriteFunction _write, const TinyGPSUbxCommand *_commands, uint8_t _count, uint32_t nowMs)
+{
+  ubx = &_ubx;
+  write = _write;
+  commands = _commands;
+  count = _count;
+  index = 0;
+  ackedCount = nakCount = 0;
+  state = Busy;
+  tries = 0;
+  send(nowMs);
+}
+
+TinyGPSUbxConfig::State TinyGPSUbxConfig::update(uint32_t nowMs)
+{
+  if (state != Busy)
+    return state;
+
+  const TinyGPSUbxCommand &cmd = commands[index];
+
+  if (cmd.ack && !answered)
+  {
+    if (ubx->ackSequence() != ackSequence && ubx->lastAckClass() == cmd.msgClass && ubx->lastAckId() == cmd.msgId)
+    {
+      if (ubx->lastAck() == TinyGPSUbx::AckAck)
+        ++ackedCount;
+      else
+        ++nakCount;
+      answered = true;
+    }
+    else if (nowMs - sentAt < _GPS_UBX_ACK_TIMEOUT)
+    {
+      return state;
+    }
+    else if (tries < _GPS_UBX_RETRIES)
+    {
+      send(nowMs);
+      return state;
+    }
+    else
+    {
+      state = Failed;
+      return state;
+    }
+  }
+
+  // After a retry the answer to an earlier try may still be on its way,
+  // and all CFG-MSG share one class and id: wait it out, so that it isn't
+  // taken for the answer to the next command
+  if (tries > 1 && nowMs - sentAt < _GPS_UBX_ACK_TIMEOUT)
+    return state;
+
+  // Next command
+  if (++index == count)
+  {
+    state = Done;
+    return state;
+  }
+
+  tries = 0;
+  send(nowMs);
+  return state;
+}
+
+void TinyGPSUbxConfig::send(uint32_t nowMs)
+{
+  const TinyGPSUbxCommand &cmd = commands[index];
+  uint8_t frame[_GPS_UBX_MAX_PAYLOAD + _GPS_UBX_FRAME_OVERHEAD];
+  uint16_t len = cmd.length < _GPS_UBX_MAX_PAYLOAD ? cmd.length : _GPS_UBX_MAX_PAYLOAD;
+
+  ackSequence = ubx->ackSequence();
+  answered = false;
+  write(frame, TinyGPSUbx::buildFrame(cmd.msgClass, cmd.msgId, cmd.payload, len, frame));
+  sentAt = nowMs;
+  ++tries;
+}
@@ -0,0 +1,212 @@
+/*
+TinyGPSUbx - u-blox UBX protocol support for TinyGPSPlus
+Copyright (C) 2026 Tauno Erik
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef __TinyGPSUbx_h
+#define __TinyGPSUbx_h
+
+#include "TinyGPS++.h"
+
+#define _GPS_UBX_SYNC_1 0xB5
+#define _GPS_UBX_SYNC_2 0x62
+#define _GPS_UBX_FRAME_OVERHEAD 8 // sync, class, id, length and checksum
+#define _GPS_UBX_MAX_PAYLOAD 100   // longer frames are skipped
+#define _GPS_UBX_MAX_LENGTH 512    // longer lengths are taken for a false sync
+#define _GPS_UBX_ACK_TIMEOUT 1000  // ms to wait for ACK-ACK/ACK-NAK, the reply can queue behind a second of NMEA at 9600 bps
+#define _GPS_UBX_RETRIES 3
+
+// Message classes
+#define UBX_CLASS_NAV 0x01
+#define UBX_CLASS_ACK 0x05
+#define UBX_CLASS_CFG 0x06
+#define UBX_CLASS_TIM 0x0D
+#define UBX_CLASS_NMEA 0xF0
+
+// Message IDs
+#define UBX_ACK_NAK 0x00
+#define UBX_ACK_ACK 0x01
+#define UBX_CFG_PRT 0x00
+#define UBX_CFG_MSG 0x01
+#define UBX_CFG_RATE 0x08
+#define UBX_NAV_PVT 0x07
+#define UBX_NAV_TIMEUTC 0x21
+#define UBX_TIM_TP 0x01
+#define UBX_NMEA_GGA 0x00
+#define UBX_NMEA_GLL 0x01
+#define UBX_NMEA_GSA 0x02
+#define UBX_NMEA_GSV 0x03
+#define UBX_NMEA_RMC 0x04
+#define UBX_NMEA_VTG 0x05
+#define UBX_NMEA_ZDA 0x08
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+#error "UBX payloads are read in place and need a little-endian target"
+#endif
+
+// Payload layouts, read in place from the frame buffer. UBX is
+// little-endian and its fields are naturally aligned.
+struct TinyGPSUbxNavTimeUtc
+{
+  uint32_t iTOW;  // GPS time of week, ms
+  uint32_t tAcc;  // time accuracy estimate, ns
+  int32_t nano;   // fraction of the second, ns
+  uint16_t year;
+  uint8_t month, day;
+  uint8_t hour, min, sec;
+  uint8_t valid;  // UBX_TIMEUTC_VALID_*
+};
+
+struct TinyGPSUbxNavPvt
+{
+  uint32_t iTOW;
+  uint16_t year;
+  uint8_t month, day;
+  uint8_t hour, min, sec;
+  uint8_t valid;  // UBX_PVT_VALID_*
+  uint32_t tAcc;
+  int32_t nano;
+  uint8_t fixType; // 2: 2D, 3: 3D, 4: GNSS + dead reckoning
+  uint8_t flags;   // UBX_PVT_FLAGS_*
+  uint8_t flags2;
+  uint8_t numSV;
+  int32_t lon, lat; // 1e-7 degrees
+  int32_t height;   // above ellipsoid, mm
+  int32_t hMSL;     // above mean sea level, mm
+  uint32_t hAcc, vAcc;
+  int32_t velN, velE, velD;
+  int32_t gSpeed;   // ground speed, mm/s
+  int32_t headMot;  // heading of motion, 1e-5 degrees
+  uint32_t sAcc, headAcc;
+  uint16_t pDOP;
+  uint8_t reserved1[6];
+  // u-blox 8 and later only
+  int32_t headVeh;
+  int16_t magDec;
+  uint16_t magAcc;
+};
+
+#define UBX_NAV_PVT_MIN_LENGTH 84 // u-blox 7 leaves out the last three fields
+
+#define UBX_TIMEUTC_VALID_UTC 0x04
+#define UBX_PVT_VALID_DATE 0x01
+#define UBX_PVT_VALID_TIME 0x02
+#define UBX_PVT_FLAGS_FIX_OK 0x01
+#define UBX_PVT_FLAGS_DIFF 0x02
+
+static_assert(sizeof(TinyGPSUbxNavTimeUtc) == 20, "NAV-TIMEUTC layout");
+static_assert(sizeof(TinyGPSUbxNavPvt) == 92, "NAV-PVT layout");
+
+// Decodes UBX frames from the same byte stream as the NMEA sentences;
+// everything outside of a UBX frame is passed on to TinyGPSPlus.
+// NAV-TIMEUTC and NAV-PVT update the date, time and location of the
+// TinyGPSPlus object like RMC and GGA do.
+class TinyGPSUbx
+{
+public:
+  enum Ack { AckNone, AckAck, AckNak };
+
+  TinyGPSUbx(TinyGPSPlus &gps);
+  bool encode(char c); // process one character, true if a UBX frame passed the checksum
+  size_t encode(const char *buf, size_t len); // returns # of valid NMEA sentences and UBX frames
+
+  static void checksum(const uint8_t *data, size_t len, uint8_t &ckA, uint8_t &ckB);
+  static size_t buildFrame(uint8_t msgClass, uint8_t msgId, const uint8_t *payload, uint16_t len, uint8_t *frame);
+
+  // The last ACK-ACK/ACK-NAK; the sequence number changes on each one
+  Ack lastAck() const               { return ack; }
+  uint8_t lastAckClass() const      { return ackClass; }
+  uint8_t lastAckId() const         { return ackId; }
+  uint32_t ackSequence() const      { return ackCount; }
+
+  uint32_t framesProcessed() const  { return frameCount; }
+  uint32_t failedChecksum() const   { return failedChecksumCount; }
+
+private:
+  enum { UBX_SYNC_1, UBX_SYNC_2, UBX_CLASS, UBX_ID, UBX_LENGTH_1, UBX_LENGTH_2, UBX_PAYLOAD, UBX_CK_A, UBX_CK_B };
+
+  TinyGPSPlus &gps;
+
+  // parsing state variables
+  uint8_t state;
+  uint8_t msgClass, msgId;
+  uint16_t length, offset;
+  uint8_t ckA, ckB;
+  union
+  {
+    uint8_t payload[_GPS_UBX_MAX_PAYLOAD];
+    TinyGPSUbxNavTimeUtc navTimeUtc;
+    TinyGPSUbxNavPvt navPvt;
+  };
+
+  // acknowledgements
+  Ack ack;
+  uint8_t ackClass, ackId;
+  uint32_t ackCount;
+
+  // statistics
+  uint32_t frameCount;
+  uint32_t failedChecksumCount;
+
+  void frameHandler();
+  void setDateTime(uint16_t year, uint8_t month, uint8_t day, uint8_t hour, uint8_t min, uint8_t sec, int32_t nano, bool date, bool time);
+  void setNavPvt();
+};
+
+struct TinyGPSUbxCommand
+{
+  uint8_t msgClass;
+  uint8_t msgId;
+  const uint8_t *payload;
+  uint16_t length;
+  bool ack; // wait for ACK-ACK/ACK-NAK before the next command
+};
+
+// Sends a list of commands one at a time, waiting for each to be
+// acknowledged and retrying on timeout. Non-blocking: call update()
+// regularly while feeding the receiver output to the TinyGPSUbx.
+class TinyGPSUbxConfig
+{
+public:
+  typedef size_t (*WriteFunction)(const uint8_t *data, size_t len);
+  enum State { Idle, Busy, Done, Failed };
+
+  TinyGPSUbxConfig() : state(Idle)
+  {}
+
+  void begin(TinyGPSUbx &ubx, WriteFunction write, const TinyGPSUbxCommand *commands, uint8_t count, uint32_t nowMs);
+  State update(uint32_t nowMs);
+
+  State status() const        { return state; }
+  uint8_t acked() const       { return ackedCount; }
+  uint8_t nakked() const      { return nakCount; }
+  uint8_t current() const     { return index; }
+
+private:
+  TinyGPSUbx *ubx;
+  WriteFunction write;
+  const TinyGPSUbxCommand *commands;
+  uint8_t count, index, tries;
+  uint8_t ackedCount, nakCount;
+  uint32_t sentAt, ackSequence;
+  bool answered;
+  State state;
+
+  void send(uint32_t nowMs);
+};
+
+#endif // def(__TinyGPSUbx_h)
@@ -0,0 +1,135 @@
+/**
+ *
+ * GPS capture format
+ * Tauno Erik
+ *
+ */
+#include <string.h>
+#include "capture.h"
+
+static const uint8_t magic[4] = {'G', 'P', 'S', 'C'};
+
+
+/**
+ * Write an unsigned number as a varint
+ * @return number of bytes written
+ */
+static size_t put_varint(uint8_t *out, uint64_t value)
+{
+  size_t n = 0;
+
+  while (value >= 0x80)
+  {
+    out[n++] = (uint8_t)value | 0x80;
+    value >>= 7;
+  }
+  out[n++] = (uint8_t)value;
+  return n;
+}
+
+
+/**
+ * Read a varint of at most max_bits
+ * @return number of bytes read, 0 if it is incomplete or too long
+ */
+static size_t get_varint(const uint8_t *in, size_t len, uint64_t &value, uint8_t max_bits)
+{
+  value = 0;
+
+  for (size_t n = 0; n < len && n * 7 < max_bits; n++)
+  {
+    value |= (uint64_t)(in[n] & 0x7F) << (n * 7);
+    if ((in[n] & 0x80) == 0)
+    {
+      return value >> max_bits == 0 ? n + 1 : 0;
+    }
+  }
+  return 0;
+}
+
+
+/**
+ * Write the file header
+ * @param out: room for CAPTURE_HEADER_SIZE bytes
+ * @return number of bytes written
+ */
+size_t capture_header(uint8_t *out)
+{
+  memcpy(out, magic, sizeof(magic));
+  out[4] = CAPTURE_VERSION;
+  out[5] = 0;
+  return CAPTURE_HEADER_SIZE;
+}
+
+
+/**
+ * @return true if the data starts with a header this version can read
+ */
+bool capture_check_header(const uint8_t *in, size_t len)
+{
+  return len >= CAPTURE_HEADER_SIZE
+         && memcmp(in, magic, sizeof(magic)) == 0
+         && in[4] == CAPTURE_VERSION;
+}
+
+
+/**
+ * Encode a record
+ * @param out: room for len + CAPTURE_MAX_OVERHEAD bytes
+ * @param delta_us: microseconds since the previous record
+ * @param kind: CAPTURE_DATA or CAPTURE_PPS
+ * @param data: the bytes of a data record
+ * @param len: number of bytes, at most CAPTURE_MAX_DATA
+ * @return number of bytes written
+ */
+size_t capture_record(uint8_t *out, uint32_t delta_us, uint8_t kind, const uint8_t *data, uint16_t len)
+{
+  size_t n = put_varint(out, (uint64_t)delta_us << 1 | (kind & 1));
+
+  if (kind == CAPTURE_DATA)
+  {
+    n += put_varint(out + n, len);
+    memcpy(out + n, data, len);
+    n += len;
+  }
+  return n;
+}
+
+
+/**
+ * Decode the next record
+ * @param in: the data after the header or the previous record
+ * @param len: number of bytes available
+ * @param record: the record; its data points into in
+ * @return number of bytes used, 0 if the record is incomplete or invalid
+ */
+size_t capture_parse(const uint8_t *in, size_t len, CaptureRecord &record)
+{
+  uint64_t value;
+  size_t n = get_varint(in, len, value, 33);
+
+  if (n == 0)
+  {
+    return 0;
+  }
+
+  record.delta_us = (uint32_t)(value >> 1);
+  record.kind = value & 1;
+  record.len = 0;
+  record.data = 0;
+
+  if (record.kind == CAPTURE_PPS)
+  {
+    return n;
+  }
+
+  size_t m = get_varint(in + n, len - n, value, 16);
+  if (m == 0 || value > CAPTURE_MAX_DATA || value > len - n - m)
+  {
+    return 0;
+  }
+
+  record.len = (uint16_t)value;
+  record.data = in + n + m;
+  return n + m + record.len;
+}
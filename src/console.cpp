@@ -0,0 +1,271 @@
+/**
+ *
+ * Serial console command interpreter
+ * Tauno Erik
+ *
+ */
+#include <ctype.h>
+#include <stdio.h>
+#include <string.h>
+#include "console.h"
+#include "hal.h"
+
+ConsoleOutput Console;
+
+static const ConsoleCommand *command_table = 0;
+static uint8_t command_count = 0;
+
+static char line[CONSOLE_LINE_SIZE + 1];
+static uint8_t line_length = 0;
+static bool line_overflow = false;
+
+// A copy of the line to split into arguments, the line stays for messages
+static char arguments[CONSOLE_LINE_SIZE + 1];
+
+// Words that may run into a command name, as in DAYLIGHTON
+static const char *const run_on_words[] = {"ON", "OFF"};
+
+
+/**
+ * Set the command table
+ * @param commands: the commands, matched without regard to case
+ * @param count: number of commands
+ */
+void console_begin(const ConsoleCommand *commands, uint8_t count)
+{
+  command_table = commands;
+  command_count = count;
+  line_length = 0;
+  line_overflow = false;
+}
+
+
+/**
+ * Add a received character to the line, run the line when it ends
+ * @param c: the character
+ * @return CONSOLE_NONE until a line ends, then the result of the line
+ */
+uint8_t console_feed(char c)
+{
+  if (c == '\r' || c == '\n')
+  {
+    if (line_overflow)
+    {
+      line_overflow = false;
+      line_length = 0;
+      return CONSOLE_OVERFLOW;
+    }
+
+    // Empty line, or the '\n' of "\r\n"
+    if (line_length == 0)
+    {
+      return CONSOLE_NONE;
+    }
+
+    line[line_length] = '\0';
+    line_length = 0;
+    memcpy(arguments, line, sizeof(arguments));
+    return console_execute(arguments);
+  }
+
+  // Backspace or delete
+  if (c == '\b' || c == 0x7F)
+  {
+    if (line_length > 0)
+    {
+      line_length--;
+    }
+    return CONSOLE_NONE;
+  }
+
+  if (line_length < CONSOLE_LINE_SIZE)
+  {
+    line[line_length++] = c;
+  }
+  else
+  {
+    line_overflow = true;
+  }
+
+  return CONSOLE_NONE;
+}
+
+
+/**
+ * May the rest of a name run into the first argument: a number with or
+ * without a sign, or one of run_on_words
+ */
+static bool is_run_on(const char *rest)
+{
+  if (*rest == '+' || *rest == '-' || isdigit((unsigned char)*rest))
+  {
+    return true;
+  }
+
+  for (const char *word : run_on_words)
+  {
+    if (strcasecmp(rest, word) == 0)
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+
+/**
+ * Split a line into arguments and run its command.
+ * The name may also run into the first argument if that is a number or
+ * ON/OFF, e.g. "OFFSET+2" is the same as "OFFSET +2"; "RAWX" is unknown.
+ * @param line: the command line, changed in place
+ * @return CONSOLE_DONE or CONSOLE_UNKNOWN
+ */
+uint8_t console_execute(char *line)
+{
+  const char *argv[CONSOLE_MAX_ARGS];
+  uint8_t argc = 0;
+
+  // Tokenize on whitespace
+  char *p = line;
+  while (*p != '\0' && argc < CONSOLE_MAX_ARGS)
+  {
+    while (isspace((unsigned char)*p))
+    {
+      *p++ = '\0';
+    }
+    if (*p == '\0')
+    {
+      break;
+    }
+    argv[argc++] = p;
+    while (*p != '\0' && !isspace((unsigned char)*p))
+    {
+      p++;
+    }
+  }
+
+  if (argc == 0)
+  {
+    return CONSOLE_UNKNOWN;
+  }
+
+  // Whole name first, then a name that runs into its argument
+  for (uint8_t pass = 0; pass < 2; pass++)
+  {
+    for (uint8_t i = 0; i < command_count; i++)
+    {
+      const ConsoleCommand &cmd = command_table[i];
+      size_t name_length = strlen(cmd.name);
+
+      if (strncasecmp(argv[0], cmd.name, name_length) != 0)
+      {
+        continue;
+      }
+
+      const char *rest = argv[0] + name_length;
+      if (*rest == '\0')
+      {
+        cmd.handler(argc, argv);
+        return CONSOLE_DONE;
+      }
+
+      if (pass == 1 && argc < CONSOLE_MAX_ARGS && is_run_on(rest))
+      {
+        // Shift the arguments up, the rest of the name becomes the first
+        memmove(&argv[2], &argv[1], (argc - 1) * sizeof(argv[0]));
+        argv[1] = rest;
+        argv[0] = cmd.name;
+        argc++;
+
+        cmd.handler(argc, argv);
+        return CONSOLE_DONE;
+      }
+    }
+  }
+
+  return CONSOLE_UNKNOWN;
+}
+
+
+/**
+ * @return the last line, for error messages
+ */
+const char *console_line()
+{
+  return line;
+}
+
+
+/**
+ * Parse a whole decimal number with an optional sign
+ * @param text: the number
+ * @param value: the number, if valid
+ * @return false if the text isn't a number
+ */
+bool console_parse_int(const char *text, int32_t &value)
+{
+  bool negative = false;
+
+  if (*text == '+' || *text == '-')
+  {
+    negative = *text == '-';
+    text++;
+  }
+
+  if (!isdigit((unsigned char)*text))
+  {
+    return false;
+  }
+
+  int32_t result = 0;
+  while (isdigit((unsigned char)*text))
+  {
+    if (result > 99999999)
+    {
+      return false;
+    }
+    result = result * 10 + (*text++ - '0');
+  }
+
+  if (*text != '\0')
+  {
+    return false;
+  }
+
+  value = negative ? -result : result;
+  return true;
+}
+
+
+size_t ConsoleOutput::write(const uint8_t *data, size_t len)
+{
+  return hal_console_write(data, len);
+}
+
+
+size_t ConsoleOutput::print(const char *text)
+{
+  return write((const uint8_t *)text, strlen(text));
+}
+
+
+size_t ConsoleOutput::print(char c)
+{
+  return write((const uint8_t *)&c, 1);
+}
+
+
+size_t ConsoleOutput::print(long number)
+{
+  char buffer[21]; // 64-bit long on a PC
+  snprintf(buffer, sizeof(buffer), "%ld", number);
+  return print(buffer);
+}
+
+
+size_t ConsoleOutput::print(unsigned long number)
+{
+  char buffer[21]; // 64-bit long on a PC
+  snprintf(buffer, sizeof(buffer), "%lu", number);
+  return print(buffer);
+}
@@ -0,0 +1,104 @@
+/**
+ *
+ * Date and time helpers
+ * Tauno Erik
+ *
+ */
+#include "date_time.h"
+
+static const int32_t SECONDS_PER_DAY = 86400;
+
+// The calendar arithmetic is done on years shifted by a multiple of 400
+// (one Gregorian cycle), so that it stays unsigned and needs no branches
+// for the sign. Dates from the year -4799 on are supported.
+static const int32_t YEAR_SHIFT = 4800;
+
+// Days from -4800-03-01, day 0 of the shifted calendar, to 2000-01-01
+static const int32_t DAYS_SHIFT = 2483589;
+
+// Day of the week of day 0 of the shifted calendar, a Wednesday
+static const uint32_t WEEKDAY_SHIFT = 3;
+
+static const int64_t SECONDS_SHIFT = (int64_t)DAYS_SHIFT * SECONDS_PER_DAY;
+
+
+/**
+ * Day number of a date (proleptic Gregorian calendar).
+ * The year starts in March, so the leap day is the last day of the year.
+ * http://howardhinnant.github.io/date_algorithms.html
+ * @param year, month, day: the date
+ * @return days since 2000-01-01, may be negative
+ */
+int32_t date_to_days(int year, int month, int day)
+{
+  const uint32_t y = (uint32_t)(year + YEAR_SHIFT) - (month <= 2);
+  const uint32_t mp = (uint32_t)(month + 9) % 12;              // March = 0
+  const uint32_t doy = (153 * mp + 2) / 5 + day - 1;           // [0, 365]
+
+  return (int32_t)(y * 365 + y / 4 - y / 100 + y / 400 + doy) - DAYS_SHIFT;
+}
+
+
+/**
+ * Date of a day number
+ * @param days: days since 2000-01-01
+ * @param dt: year, month, day and weekday are set
+ */
+void days_to_date(int32_t days, DateTime &dt)
+{
+  const uint32_t z = (uint32_t)(days + DAYS_SHIFT);
+  const uint32_t era = z / 146097;
+  const uint32_t doe = z - era * 146097;                                   // [0, 146096]
+  const uint32_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365; // [0, 399]
+  const uint32_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);            // [0, 365]
+  const uint32_t mp = (5 * doy + 2) / 153;                                 // [0, 11]
+  const uint32_t month = mp + 3 - 12 * (mp >= 10);
+
+  dt.day = doy - (153 * mp + 2) / 5 + 1;
+  dt.month = month;
+  dt.year = (int32_t)(era * 400 + yoe + (month <= 2)) - YEAR_SHIFT;
+  dt.weekday = (z + WEEKDAY_SHIFT) % 7;
+}
+
+
+/**
+ * Day of the week of a day number
+ * @param days: days since 2000-01-01
+ * @return 0 = Sunday ... 6 = Saturday
+ */
+uint8_t day_of_week(int32_t days)
+{
+  return ((uint32_t)(days + DAYS_SHIFT) + WEEKDAY_SHIFT) % 7;
+}
+
+
+/**
+ * Convert a date and time to the clock epoch
+ * @param dt: date and time; the weekday isn't used
+ * @return seconds since 2000-01-01 00:00:00
+ */
+int64_t date_time_to_epoch(const DateTime &dt)
+{
+  return (int64_t)date_to_days(dt.year, dt.month, dt.day) * SECONDS_PER_DAY
+         + dt.hour * 3600L + dt.minute * 60L + dt.second;
+}
+
+
+/**
+ * Convert clock epoch to date and time
+ * @param seconds: seconds since 2000-01-01 00:00:00
+ * @param dt: DateTime struct to store the date and time
+ */
+void epoch_to_date_time(int64_t seconds, DateTime &dt)
+{
+  // Shifted to be positive, the division rounds down for times before 2000
+  const uint64_t shifted = (uint64_t)(seconds + SECONDS_SHIFT);
+  const uint32_t days = shifted / SECONDS_PER_DAY;
+  const uint32_t second_of_day = shifted - (uint64_t)days * SECONDS_PER_DAY;
+
+  days_to_date((int32_t)days - DAYS_SHIFT, dt);
+
+  dt.hour = second_of_day / 3600;
+  dt.minute = (second_of_day / 60) % 60;
+  dt.second = second_of_day % 60;
+}
@@ -0,0 +1,172 @@
+/**
+ *
+ * Disciplined local clock with holdover
+ * Tauno Erik
+ *
+ */
+#include <math.h>
+#include "disciplined_clock.h"
+
+static const uint64_t US_PER_SECOND = 1000000ULL;
+
+// Without a sync for this long the clock is in holdover
+static const uint64_t HOLDOVER_AFTER_US = 2 * US_PER_SECOND;
+
+// A time this far from the prediction is a jump, not drift
+static const int64_t STEP_LIMIT_US = 1 * US_PER_SECOND;
+
+// Shortest interval used to measure the frequency
+static const uint64_t MIN_FREQ_INTERVAL_US = 16 * US_PER_SECOND;
+
+// Frequency uncertainty before anything is learned (crystal tolerance)
+static const float INITIAL_FREQ_ERROR_PPB = 50000.0f;
+
+// How fast the crystal frequency may wander (temperature), ppb per second
+static const float FREQ_WANDER_PPB_PER_S = 0.1f;
+
+static bool synced = false;
+
+// Phase reference: local time of the last sync and the UTC time it represents
+static uint64_t ref_local_us = 0;
+static uint64_t ref_utc_us = 0;
+static uint32_t ref_uncertainty_us = 0;
+
+// Start of the current frequency measurement
+static uint64_t anchor_local_us = 0;
+static uint64_t anchor_utc_us = 0;
+static uint32_t anchor_uncertainty_us = 0;
+
+// Local clock rate error (positive = local clock runs fast) and its uncertainty
+static float freq_ppb = 0.0f;
+static float freq_error_ppb = INITIAL_FREQ_ERROR_PPB;
+
+
+/**
+ * UTC microseconds since 2000 predicted for a local time
+ */
+static uint64_t predict_utc_us(uint64_t local_us)
+{
+  int64_t elapsed = (int64_t)(local_us - ref_local_us);
+  int64_t correction = (int64_t)((float)elapsed * freq_ppb / 1e9f);
+
+  return ref_utc_us + elapsed - correction;
+}
+
+
+/**
+ * Steer the clock with a GPS time
+ * @param local_us: local time when the GPS time was valid
+ * @param utc: GPS time
+ * @param uncertainty_us: how exact local_us is (jitter)
+ */
+void dclock_sync(uint64_t local_us, const Epoch &utc, uint32_t uncertainty_us)
+{
+  uint64_t utc_us = utc.seconds * US_PER_SECOND + utc.micros;
+
+  if (synced)
+  {
+    int64_t phase_error = (int64_t)(utc_us - predict_utc_us(local_us));
+
+    if (phase_error > STEP_LIMIT_US || phase_error < -STEP_LIMIT_US)
+    {
+      // Time jumped, restart the frequency measurement
+      synced = false;
+    }
+  }
+
+  if (!synced)
+  {
+    anchor_local_us = local_us;
+    anchor_utc_us = utc_us;
+    anchor_uncertainty_us = uncertainty_us;
+    synced = true;
+  }
+  else
+  {
+    uint64_t interval = local_us - anchor_local_us;
+    float measurement_error = 1e9f * (anchor_uncertainty_us + uncertainty_us) / (float)interval;
+
+    // Measure the frequency once the interval is long enough to improve the estimate
+    if (interval >= MIN_FREQ_INTERVAL_US && measurement_error < freq_error_ppb)
+    {
+      float measured = 1e9f * ((float)(int64_t)(interval - (utc_us - anchor_utc_us)) / (float)interval);
+      float wander = FREQ_WANDER_PPB_PER_S * (float)(interval / US_PER_SECOND);
+      float estimate_var = (freq_error_ppb + wander) * (freq_error_ppb + wander);
+      float measured_var = measurement_error * measurement_error;
+
+      // Combine by inverse variance
+      freq_ppb += (measured - freq_ppb) * estimate_var / (estimate_var + measured_var);
+      freq_error_ppb = sqrtf(estimate_var * measured_var / (estimate_var + measured_var));
+
+      anchor_local_us = local_us;
+      anchor_utc_us = utc_us;
+      anchor_uncertainty_us = uncertainty_us;
+    }
+  }
+
+  ref_local_us = local_us;
+  ref_utc_us = utc_us;
+  ref_uncertainty_us = uncertainty_us;
+}
+
+
+/**
+ * Current UTC time
+ * @param local_us: local time now
+ * @param utc: UTC time
+ * @return true if the clock has been synced; otherwise, false
+ */
+bool dclock_now(uint64_t local_us, Epoch &utc)
+{
+  if (!synced)
+  {
+    return false;
+  }
+
+  uint64_t utc_us = predict_utc_us(local_us);
+
+  utc.seconds = utc_us / US_PER_SECOND;
+  utc.micros = utc_us % US_PER_SECOND;
+
+  return true;
+}
+
+
+/**
+ * @return true if the clock runs without GPS time
+ */
+bool dclock_is_holdover(uint64_t local_us)
+{
+  return synced && local_us - ref_local_us > HOLDOVER_AFTER_US;
+}
+
+
+/**
+ * Estimated error of the clock
+ * @param local_us: local time now
+ * @return error in microseconds
+ */
+uint32_t dclock_error_us(uint64_t local_us)
+{
+  if (!synced)
+  {
+    return UINT32_MAX;
+  }
+
+  float elapsed_s = (float)(local_us - ref_local_us) / US_PER_SECOND;
+  float error = ref_uncertainty_us
+                + freq_error_ppb * elapsed_s / 1000.0f
+                + FREQ_WANDER_PPB_PER_S * elapsed_s * elapsed_s / 2000.0f;
+
+  return error < 4e9f ? (uint32_t)error : UINT32_MAX;
+}
+
+
+/**
+ * Learned frequency error of the local clock
+ * @return parts per billion, positive when the local clock runs fast
+ */
+int32_t dclock_drift_ppb()
+{
+  return (int32_t)freq_ppb;
+}
@@ -0,0 +1,122 @@
+/**
+ *
+ * 74HC595 display driver
+ * Tauno Erik
+ *
+ */
+#if defined(ARDUINO)
+#include <Arduino.h>
+#include "display.h"
+
+#if defined(DISPLAY_USE_HW_SPI)
+#include <SPI.h>
+
+// 74HC595 is good for 20+ MHz at 3.3 V
+static const uint32_t DISPLAY_SPI_CLOCK = 8000000;
+#endif
+
+static uint8_t latch_pin_nr;
+
+#if !defined(DISPLAY_USE_HW_SPI)
+static uint8_t data_pin_nr;
+static uint8_t clock_pin_nr;
+#endif
+
+
+/**
+ * Initialize the shift register pins
+ */
+void display_begin(uint8_t data_pin, uint8_t latch_pin, uint8_t clock_pin)
+{
+  latch_pin_nr = latch_pin;
+  pinMode(latch_pin, OUTPUT);
+
+#if defined(DISPLAY_USE_HW_SPI)
+  (void)data_pin;
+  (void)clock_pin;
+  SPI.begin();
+  SPI.setFrequency(DISPLAY_SPI_CLOCK);
+  SPI.setDataMode(SPI_MODE0);
+  SPI.setBitOrder(MSBFIRST);
+#else
+  data_pin_nr = data_pin;
+  clock_pin_nr = clock_pin;
+  pinMode(data_pin, OUTPUT);
+  pinMode(clock_pin, OUTPUT);
+#endif
+}
+
+
+/**
+ * Reverse the bits of a 32-bit word
+ */
+static inline uint32_t reverse_bits(uint32_t x)
+{
+  x = ((x >> 1) & 0x55555555UL) | ((x & 0x55555555UL) << 1);
+  x = ((x >> 2) & 0x33333333UL) | ((x & 0x33333333UL) << 2);
+  x = ((x >> 4) & 0x0F0F0F0FUL) | ((x & 0x0F0F0F0FUL) << 4);
+  x = ((x >> 8) & 0x00FF00FFUL) | ((x & 0x00FF00FFUL) << 8);
+  return (x >> 16) | (x << 16);
+}
+
+
+/**
+ * Function to write data to the shift register
+ * @param data: 32-bit data to write to the shift register
+ */
+void display_write(uint32_t data)
+{
+  // Always shift out MSB first, LSBFIRST is a bit reversal
+  if (DISPLAY_BIT_ORDER == LSBFIRST)
+  {
+    data = reverse_bits(data);
+  }
+
+#if defined(DISPLAY_USE_HW_SPI)
+  digitalWrite(latch_pin_nr, LOW);
+  SPI.write32(data, true);
+  digitalWrite(latch_pin_nr, HIGH);
+
+#elif defined(ESP8266)
+  // GPIO 0-15 set/clear registers, one store per edge
+  const uint32_t data_mask = 1UL << data_pin_nr;
+  const uint32_t clock_mask = 1UL << clock_pin_nr;
+  const uint32_t latch_mask = 1UL << latch_pin_nr;
+
+  GPOC = latch_mask;
+
+  for (uint8_t i = 0; i < 32; i++)
+  {
+    if (data & 0x80000000UL)
+    {
+      GPOS = data_mask;
+    }
+    else
+    {
+      GPOC = data_mask;
+    }
+    data <<= 1;
+
+    // Pulse the clock pin to shift the bit into the 74HC595
+    GPOS = clock_mask;
+    GPOC = clock_mask;
+  }
+
+  GPOS = latch_mask;
+
+#else
+  digitalWrite(latch_pin_nr, LOW);
+
+  for (uint8_t i = 0; i < 32; i++)
+  {
+    digitalWrite(data_pin_nr, (data & 0x80000000UL) ? HIGH : LOW);
+    data <<= 1;
+    digitalWrite(clock_pin_nr, HIGH);
+    digitalWrite(clock_pin_nr, LOW);
+  }
+
+  digitalWrite(latch_pin_nr, HIGH);
+#endif
+}
+
+#endif // ARDUINO
@@ -0,0 +1,230 @@
+/**
+ *
+ * Display frame compositor
+ * Tauno Erik
+ *
+ */
+#include <string.h>
+#include "frame.h"
+#include "display.h"
+
+// Lookup table for digits 0-9
+// MSBFIRST
+// 0 - ON, 1 - OFF
+static const uint8_t digits[10] = {
+  0b00000011, // 0
+  0b10011111, // 1
+  0b00100101, // 2
+  0b00001101, // 3
+  0b10011001, // 4
+  0b01001001, // 5
+  0b11000001, // 6
+  0b00011111, // 7
+  0b00000001, // 8
+  0b00001001  // 9
+};
+
+// 7-segment led bits
+// a = 0b01111111, b = 0b10111111, c = 0b11011111, d = 0b11101111,
+// e = 0b11110111, f = 0b11111011, g = 0b11111101, dp = 0b11111110
+
+// Two digits 00-59 side by side, built at compile time,
+// so hours and minutes need no division
+struct DigitPairs {
+  uint16_t segments[60];
+
+  constexpr DigitPairs() : segments()
+  {
+    for (int i = 0; i < 60; i++)
+    {
+      segments[i] = digits[i / 10] << 8 | digits[i % 10];
+    }
+  }
+};
+
+static constexpr DigitPairs digit_pairs;
+
+// The dot between hours and minutes
+static const uint8_t hour_minut_dot_pos = 16;
+static const uint32_t dot_bitmask = 1UL << hour_minut_dot_pos;
+
+// Segment a of every digit, then round the display clockwise
+static const uint32_t overlay_patterns[] = {
+  0b11111111111111111111111101111111,
+  0b11111111111111110111111111111111,
+  0b11111111011111111111111111111111,
+  0b01111111111111111111111111111111,
+  0b11111011111111111111111111111111,
+  0b11110111111111111111111111111111,
+  0b11101111111111111111111111111111,
+  0b11111111111011111111111111111111,
+  0b11111111111111111110111111111111,
+  0b11111111111111111111111111101111,
+  0b11111111111111111111111111011111,
+  0b11111111111111111111111110111111
+};
+
+static const uint8_t num_overlay_patterns = sizeof(overlay_patterns) / sizeof(overlay_patterns[0]);
+
+// Layers
+static uint32_t digits_layer = 0xFFFFFFFFUL; // Blank until the first time
+static bool dot_on = false;
+static uint32_t overlay_layer = FRAME_NO_OVERLAY;
+static uint8_t overlay_index = 0;
+
+// Shown time, to skip recomposing the digits
+static uint8_t shown_hour = 0xFF;
+static uint8_t shown_minute = 0xFF;
+
+// Last frame in the shift registers
+static uint32_t latched_frame = 0;
+static bool latched = false;
+
+static uint32_t pushed_count = 0;
+static uint32_t skipped_count = 0;
+
+
+/**
+ * Show hours and minutes
+ */
+void frame_set_time(uint8_t hour, uint8_t minute)
+{
+  if (hour == shown_hour && minute == shown_minute)
+  {
+    return;
+  }
+
+  shown_hour = hour;
+  shown_minute = minute;
+  digits_layer = (uint32_t)digit_pairs.segments[hour % 60] << 16 | digit_pairs.segments[minute % 60];
+}
+
+
+/**
+ * Turn off all digits
+ */
+void frame_clear_digits()
+{
+  shown_hour = shown_minute = 0xFF;
+  digits_layer = 0xFFFFFFFFUL;
+}
+
+
+void frame_set_dot(bool on)
+{
+  dot_on = on;
+}
+
+
+void frame_toggle_dot()
+{
+  dot_on = !dot_on;
+}
+
+
+/**
+ * Segments to turn on over the digits
+ * @param overlay: 0 - ON, FRAME_NO_OVERLAY to remove
+ */
+void frame_set_overlay(uint32_t overlay)
+{
+  overlay_layer = overlay;
+}
+
+
+/**
+ * Advance the overlay animation by one pattern
+ */
+void frame_overlay_step()
+{
+  overlay_layer = overlay_patterns[overlay_index];
+
+  overlay_index++;
+  if (overlay_index >= num_overlay_patterns)
+  {
+    overlay_index = 0;
+  }
+}
+
+
+/**
+ * Compose the layers and write the frame if it differs from the shown one
+ * @return true if the display was written
+ */
+bool frame_flush()
+{
+  uint32_t frame = digits_layer & overlay_layer;
+
+  if (dot_on)
+  {
+    frame &= ~dot_bitmask;
+  }
+
+  if (latched && frame == latched_frame)
+  {
+    skipped_count++;
+    return false;
+  }
+
+  display_write(frame);
+  latched_frame = frame;
+  latched = true;
+  pushed_count++;
+
+  return true;
+}
+
+
+/**
+ * The digits of a frame as text, e.g. for a display on a PC
+ * @param frame: the 32-bit frame
+ * @param text: room for 6 characters, e.g. "12:34"; a blank digit is
+ *              ' ', other segments are '?', the dot is ':' when it is on
+ */
+void frame_text(uint32_t frame, char *text)
+{
+  static const uint8_t positions[4] = {0, 1, 3, 4};
+
+  strcpy(text, "  :  ");
+  if (frame & dot_bitmask)
+  {
+    text[2] = ' ';
+  }
+
+  // Hour tens in the top byte, the dot is bit 0 of each digit
+  for (uint8_t i = 0; i < 4; i++)
+  {
+    uint8_t segments = frame >> (24 - i * 8) | 1;
+    if (segments == 0xFF)
+    {
+      continue;
+    }
+
+    text[positions[i]] = '?';
+    for (uint8_t digit = 0; digit < 10; digit++)
+    {
+      if (segments == digits[digit])
+      {
+        text[positions[i]] = '0' + digit;
+      }
+    }
+  }
+}
+
+
+/**
+ * Number of frames written to the display
+ */
+uint32_t frame_pushed_count()
+{
+  return pushed_count;
+}
+
+
+/**
+ * Number of refreshes skipped because nothing changed
+ */
+uint32_t frame_skipped_count()
+{
+  return skipped_count;
+}
@@ -0,0 +1,155 @@
+/**
+ *
+ * u-blox NEO-6M receiver configuration
+ * Tauno Erik
+ *
+ */
+#include "gps_config.h"
+
+// CFG-MSG: message class, message id, rate on the current port
+static const uint8_t disable_gsv[] = {UBX_CLASS_NMEA, UBX_NMEA_GSV, 0};
+static const uint8_t disable_gll[] = {UBX_CLASS_NMEA, UBX_NMEA_GLL, 0};
+static const uint8_t disable_vtg[] = {UBX_CLASS_NMEA, UBX_NMEA_VTG, 0};
+static const uint8_t disable_gsa[] = {UBX_CLASS_NMEA, UBX_NMEA_GSA, 0};
+static const uint8_t enable_zda[]  = {UBX_CLASS_NMEA, UBX_NMEA_ZDA, 1};
+static const uint8_t enable_utc[]  = {UBX_CLASS_NAV, UBX_NAV_TIMEUTC, 1};
+static const uint8_t disable_rmc[] = {UBX_CLASS_NMEA, UBX_NMEA_RMC, 0};
+
+// CFG-RATE: measurement period (ms), cycles per solution, UTC time reference
+static const uint8_t nav_rate[] = {
+  GPS_MEASURE_RATE_MS & 0xFF, GPS_MEASURE_RATE_MS >> 8,
+  1, 0,
+  0, 0
+};
+
+// CFG-PRT: UART1, 8N1, new baud rate, UBX+NMEA in, UBX+NMEA out
+static const uint8_t port[] = {
+  1, 0,
+  0, 0,
+  0xD0, 0x08, 0x00, 0x00,
+  GPS_CONFIG_BAUD & 0xFF, (GPS_CONFIG_BAUD >> 8) & 0xFF, (GPS_CONFIG_BAUD >> 16) & 0xFF, GPS_CONFIG_BAUD >> 24,
+  0x07, 0x00,
+  0x03, 0x00,
+  0, 0,
+  0, 0
+};
+
+// NAV-TIMEUTC takes over the date and time from RMC, binary is cheaper
+// to decode. GGA stays on for the position.
+// The module answers the port change at the new baud rate, if at all,
+// so it is sent last and not waited for.
+static const TinyGPSUbxCommand commands[] = {
+  {UBX_CLASS_CFG, UBX_CFG_MSG, disable_gsv, sizeof(disable_gsv), true},
+  {UBX_CLASS_CFG, UBX_CFG_MSG, disable_gll, sizeof(disable_gll), true},
+  {UBX_CLASS_CFG, UBX_CFG_MSG, disable_vtg, sizeof(disable_vtg), true},
+  {UBX_CLASS_CFG, UBX_CFG_MSG, disable_gsa, sizeof(disable_gsa), true},
+  {UBX_CLASS_CFG, UBX_CFG_MSG, enable_zda, sizeof(enable_zda), true},
+  {UBX_CLASS_CFG, UBX_CFG_MSG, enable_utc, sizeof(enable_utc), true},
+  {UBX_CLASS_CFG, UBX_CFG_MSG, disable_rmc, sizeof(disable_rmc), true},
+  {UBX_CLASS_CFG, UBX_CFG_RATE, nav_rate, sizeof(nav_rate), true},
+  {UBX_CLASS_CFG, UBX_CFG_PRT, port, sizeof(port), false},
+};
+
+static TinyGPSUbxConfig config;
+static TinyGPSUbx *config_ubx;
+static gps_config_write config_write;
+static gps_config_set_baud config_set_baud;
+static uint32_t config_baud;
+static uint32_t initial_baud;
+static uint8_t state = GPS_CONFIG_FAILED;
+
+
+/**
+ * Start sending the configuration
+ * @param ubx: decoder of the GPS module output, for the acknowledgements
+ * @param write: sends bytes to the GPS module
+ * @param set_baud: changes the baud rate of the serial port
+ * @param baud: current baud rate of the serial port
+ * @param now_ms: current time in ms
+ */
+void gps_config_begin(TinyGPSUbx &ubx, gps_config_write write, gps_config_set_baud set_baud, uint32_t baud, uint32_t now_ms)
+{
+  config_ubx = &ubx;
+  config_write = write;
+  config_set_baud = set_baud;
+  config_baud = baud;
+  initial_baud = baud;
+  state = GPS_CONFIG_BUSY;
+
+  config.begin(ubx, write, commands, sizeof(commands) / sizeof(commands[0]), now_ms);
+}
+
+
+/**
+ * Advance the configuration, call it regularly while busy
+ * @param now_ms: current time in ms
+ * @return GPS_CONFIG_BUSY, GPS_CONFIG_DONE or GPS_CONFIG_FAILED
+ */
+uint8_t gps_config_update(uint32_t now_ms)
+{
+  if (state != GPS_CONFIG_BUSY)
+  {
+    return state;
+  }
+
+  switch (config.update(now_ms))
+  {
+    case TinyGPSUbxConfig::Done:
+      // The port command is on its way, follow the module
+      config_baud = GPS_CONFIG_BAUD;
+      config_set_baud(config_baud);
+      state = GPS_CONFIG_DONE;
+      break;
+
+    case TinyGPSUbxConfig::Failed:
+      // No answer at all: the module may still run at the new baud
+      // rate from before a reset of the ESP8266, try once more there
+      if (config.current() == 0 && config_baud != GPS_CONFIG_BAUD)
+      {
+        config_baud = GPS_CONFIG_BAUD;
+        config_set_baud(config_baud);
+        config.begin(*config_ubx, config_write, commands, sizeof(commands) / sizeof(commands[0]), now_ms);
+      }
+      else
+      {
+        // Not a u-blox module, or not listening: keep the factory baud rate
+        if (config_baud != initial_baud)
+        {
+          config_baud = initial_baud;
+          config_set_baud(config_baud);
+        }
+        state = GPS_CONFIG_FAILED;
+      }
+      break;
+
+    default:
+      break;
+  }
+
+  return state;
+}
+
+
+/**
+ * @return current baud rate of the serial port
+ */
+uint32_t gps_config_baud()
+{
+  return config_baud;
+}
+
+/**
+ * @return number of commands the module accepted
+ */
+uint8_t gps_config_acked()
+{
+  return config.acked();
+}
+
+/**
+ * @return number of commands the module rejected
+ */
+uint8_t gps_config_nakked()
+{
+  return config.nakked();
+}
@@ -0,0 +1,151 @@
+/**
+ *
+ * GPS module serial ingestion
+ * Tauno Erik
+ *
+ */
+#include "gps_uart.h"
+#include "hal.h"
+#include "ring_buffer.h"
+
+static RingBuffer<GPS_UART_RING_SIZE> ring;
+
+static uint8_t gps_rx_pin;
+static uint8_t gps_tx_pin;
+
+static gps_uart_tap tap = 0;
+
+// Counters
+static volatile uint32_t received = 0;  // Bytes received
+static volatile uint32_t dropped = 0;   // Bytes lost because the ring was full
+static uint32_t overflows = 0;          // Receiver buffer overflows
+static volatile size_t high_water = 0;  // Most bytes waiting in the ring
+
+
+/**
+ * Move everything the receiver has into the ring.
+ * This is the only producer of the ring, but it runs from two places:
+ * the receiver's onReceive handler, which EspSoftwareSerial runs through
+ * schedule_function() after loop() has returned (not while loop() waits
+ * in delay()), and gps_uart_available(). That is safe only because both
+ * run in loop context and never interrupt each other; called from an
+ * interrupt, this would race with itself.
+ */
+static void gps_uart_receive()
+{
+  uint8_t chunk[32];
+  size_t available;
+
+  while ((available = hal_gps_available()) > 0)
+  {
+    size_t len = available < sizeof(chunk) ? available : sizeof(chunk);
+    len = hal_gps_read(chunk, len);
+    if (len == 0)
+    {
+      break;
+    }
+
+    if (tap != 0)
+    {
+      tap(chunk, len);
+    }
+
+    size_t stored = ring.push(chunk, len);
+    received = received + len;
+    dropped = dropped + (len - stored);
+
+    size_t used = ring.size();
+    if (used > high_water)
+    {
+      high_water = used;
+    }
+  }
+}
+
+
+/**
+ * Start receiving from the GPS module
+ */
+void gps_uart_begin(uint8_t rx_pin, uint8_t tx_pin, uint32_t baud)
+{
+  gps_rx_pin = rx_pin;
+  gps_tx_pin = tx_pin;
+
+  hal_gps_begin(rx_pin, tx_pin, baud, GPS_UART_RX_BUFFER_SIZE, gps_uart_receive);
+}
+
+
+/**
+ * Change the baud rate, e.g. after the GPS module was configured
+ */
+void gps_uart_set_baud(uint32_t baud)
+{
+  hal_gps_end();
+  gps_uart_begin(gps_rx_pin, gps_tx_pin, baud);
+}
+
+
+/**
+ * @return number of bytes waiting to be read
+ */
+size_t gps_uart_available()
+{
+  if (hal_gps_overflow())
+  {
+    overflows++;
+  }
+
+  gps_uart_receive();
+  return ring.size();
+}
+
+
+/**
+ * Take a batch of bytes
+ * @param buffer: where to copy the bytes
+ * @param len: size of the buffer
+ * @return number of bytes copied
+ */
+size_t gps_uart_read(char *buffer, size_t len)
+{
+  return ring.pop((uint8_t *)buffer, len);
+}
+
+
+/**
+ * Send bytes to the GPS module
+ */
+size_t gps_uart_write(const uint8_t *data, size_t len)
+{
+  return hal_gps_write(data, len);
+}
+
+
+/**
+ * Set the function that sees every received chunk, 0 for none
+ */
+void gps_uart_set_tap(gps_uart_tap new_tap)
+{
+  tap = new_tap;
+}
+
+
+uint32_t gps_uart_received()
+{
+  return received;
+}
+
+uint32_t gps_uart_dropped()
+{
+  return dropped;
+}
+
+uint32_t gps_uart_overflows()
+{
+  return overflows;
+}
+
+size_t gps_uart_high_water()
+{
+  return high_water;
+}
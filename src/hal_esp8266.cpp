@@ -0,0 +1,172 @@
+/**
+ *
+ * Hardware abstraction layer: ESP8266 backend
+ * Tauno Erik
+ *
+ */
+#if defined(ESP8266)
+#include <Arduino.h>
+#include <ESP8266WiFi.h>
+#include <SoftwareSerial.h>
+#include "hal.h"
+
+extern "C" {
+#include "spi_flash.h"
+}
+
+// The sector reserved for the EEPROM library by the linker script
+extern "C" uint32_t _EEPROM_start;
+#define STORE_SECTOR (((uint32_t)&_EEPROM_start - 0x40200000) / SPI_FLASH_SEC_SIZE)
+
+static_assert(HAL_STORE_SIZE == SPI_FLASH_SEC_SIZE, "The store is one flash sector");
+
+static SoftwareSerial gps_serial;
+
+
+/**********************************************
+ * Clock source
+ **********************************************/
+uint32_t hal_millis()
+{
+  return millis();
+}
+
+uint32_t hal_micros()
+{
+  return micros();
+}
+
+uint64_t hal_micros64()
+{
+  return micros64();
+}
+
+/**
+ * Idle; with the modem off the chip sleeps meanwhile
+ */
+void hal_delay(uint32_t ms)
+{
+  delay(ms);
+}
+
+/**
+ * CPU cycles, wraps around every 53 s at 80 MHz. Called from the PPS interrupt.
+ */
+uint32_t IRAM_ATTR hal_cycle_count()
+{
+  return ESP.getCycleCount();
+}
+
+uint32_t hal_cpu_mhz()
+{
+  return ESP.getCpuFreqMHz();
+}
+
+/**
+ * Call isr on the rising edge of the PPS pin
+ */
+void hal_pps_begin(uint8_t pin, hal_callback isr)
+{
+  pinMode(pin, INPUT);
+  attachInterrupt(digitalPinToInterrupt(pin), isr, RISING);
+}
+
+void hal_disable_interrupts()
+{
+  noInterrupts();
+}
+
+void hal_enable_interrupts()
+{
+  interrupts();
+}
+
+/**
+ * The clock doesn't use WiFi
+ */
+void hal_radio_off()
+{
+  WiFi.mode(WIFI_OFF);
+  WiFi.forceSleepBegin();
+}
+
+
+/**********************************************
+ * Serial console
+ **********************************************/
+void hal_console_begin(uint32_t baud)
+{
+  Serial.begin(baud);
+}
+
+size_t hal_console_available()
+{
+  return Serial.available();
+}
+
+int hal_console_read()
+{
+  return Serial.read();
+}
+
+size_t hal_console_write(const uint8_t *data, size_t len)
+{
+  return Serial.write(data, len);
+}
+
+
+/**********************************************
+ * GPS module
+ **********************************************/
+void hal_gps_begin(uint8_t rx_pin, uint8_t tx_pin, uint32_t baud, size_t buffer_size, hal_callback on_receive)
+{
+  gps_serial.begin(baud, SWSERIAL_8N1, rx_pin, tx_pin, false, buffer_size);
+  gps_serial.onReceive(on_receive);
+}
+
+void hal_gps_end()
+{
+  gps_serial.end();
+}
+
+size_t hal_gps_available()
+{
+  int available = gps_serial.available();
+  return available > 0 ? available : 0;
+}
+
+size_t hal_gps_read(uint8_t *buffer, size_t len)
+{
+  return gps_serial.read(buffer, len);
+}
+
+size_t hal_gps_write(const uint8_t *data, size_t len)
+{
+  return gps_serial.write(data, len);
+}
+
+bool hal_gps_overflow()
+{
+  return gps_serial.overflow();
+}
+
+
+/**********************************************
+ * Persistent store: the EEPROM sector
+ **********************************************/
+bool hal_store_read(uint16_t offset, uint32_t *data, uint16_t len)
+{
+  return ESP.flashRead(STORE_SECTOR * HAL_STORE_SIZE + offset, data, len);
+}
+
+bool hal_store_write(uint16_t offset, const uint32_t *data, uint16_t len)
+{
+  return ESP.flashWrite(STORE_SECTOR * HAL_STORE_SIZE + offset, data, len);
+}
+
+bool hal_store_erase()
+{
+  return ESP.flashEraseSector(STORE_SECTOR);
+}
+
+#endif // ESP8266
@@ -0,0 +1,362 @@
+/**
+ *
+ * Hardware abstraction layer: Linux backend (env:native)
+ * Tauno Erik
+ *
+ * Runs the clock in real time on a PC:
+ *   console - stdin and stdout
+ *   GPS     - the serial port or FIFO named by the GPS_DEVICE environment
+ *             variable, e.g. GPS_DEVICE=/dev/ttyUSB0 for a USB-serial
+ *             adapter on the module. There is no PPS input.
+ *   display - the digits are printed to stderr when they change
+ *   store   - the file gps_clock.store in the working directory
+ *
+ */
+#if !defined(ARDUINO)
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+#include "hal.h"
+#include "display.h"
+#include "frame.h"
+
+// The firmware
+void setup();
+void loop();
+
+static const uint32_t CPU_MHZ = 80;
+static const char STORE_FILE[] = "gps_clock.store";
+
+static uint64_t start_ns = 0;
+
+// GPS module
+static int gps_fd = -1;
+static bool gps_is_tty = false;
+static hal_callback gps_on_receive = 0;
+static uint8_t gps_buffer[4096];
+static size_t gps_buffer_size = 0; // as on the ESP8266
+static size_t gps_buffered = 0;
+static bool gps_overflowed = false;
+
+// Store
+static uint8_t sector[HAL_STORE_SIZE];
+static bool sector_loaded = false;
+
+
+int main()
+{
+  setup();
+  for (;;)
+  {
+    loop();
+
+    // EspSoftwareSerial schedules its receive handler, which runs once
+    // loop() has returned
+    struct pollfd fd = {gps_fd, POLLIN, 0};
+    if (gps_on_receive != 0 && poll(&fd, gps_fd >= 0 ? 1 : 0, 0) > 0)
+    {
+      gps_on_receive();
+    }
+  }
+}
+
+
+/**********************************************
+ * Clock source
+ **********************************************/
+static uint64_t now_ns()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  uint64_t ns = (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+
+  if (start_ns == 0)
+  {
+    start_ns = ns;
+  }
+  return ns - start_ns;
+}
+
+uint32_t hal_millis()
+{
+  return (uint32_t)(now_ns() / 1000000);
+}
+
+uint32_t hal_micros()
+{
+  return (uint32_t)(now_ns() / 1000);
+}
+
+uint64_t hal_micros64()
+{
+  return now_ns() / 1000;
+}
+
+/**
+ * Sleep; GPS data arriving meanwhile waits in the serial port
+ */
+void hal_delay(uint32_t ms)
+{
+  struct timespec ts = {(time_t)(ms / 1000), (long)(ms % 1000) * 1000000L};
+  while (nanosleep(&ts, &ts) != 0)
+  {
+  }
+}
+
+uint32_t hal_cycle_count()
+{
+  return (uint32_t)(now_ns() * CPU_MHZ / 1000);
+}
+
+uint32_t hal_cpu_mhz()
+{
+  return CPU_MHZ;
+}
+
+void hal_pps_begin(uint8_t pin, hal_callback isr)
+{
+  (void)pin;
+  (void)isr;
+}
+
+void hal_disable_interrupts()
+{
+}
+
+void hal_enable_interrupts()
+{
+}
+
+void hal_radio_off()
+{
+}
+
+
+/**********************************************
+ * Serial console
+ **********************************************/
+void hal_console_begin(uint32_t baud)
+{
+  (void)baud;
+  fcntl(STDIN_FILENO, F_SETFL, fcntl(STDIN_FILENO, F_GETFL) | O_NONBLOCK);
+}
+
+size_t hal_console_available()
+{
+  struct pollfd fd = {STDIN_FILENO, POLLIN, 0};
+  return poll(&fd, 1, 0) > 0 && (fd.revents & POLLIN) ? 1 : 0;
+}
+
+int hal_console_read()
+{
+  uint8_t c;
+  return read(STDIN_FILENO, &c, 1) == 1 ? c : -1;
+}
+
+size_t hal_console_write(const uint8_t *data, size_t len)
+{
+  size_t written = fwrite(data, 1, len, stdout);
+  fflush(stdout);
+  return written;
+}
+
+
+/**********************************************
+ * GPS module
+ **********************************************/
+static speed_t baud_to_speed(uint32_t baud)
+{
+  switch (baud)
+  {
+    case 4800:   return B4800;
+    case 19200:  return B19200;
+    case 38400:  return B38400;
+    case 57600:  return B57600;
+    case 115200: return B115200;
+    case 230400: return B230400;
+    default:     return B9600;
+  }
+}
+
+void hal_gps_begin(uint8_t rx_pin, uint8_t tx_pin, uint32_t baud, size_t buffer_size, hal_callback on_receive)
+{
+  (void)rx_pin;
+  (void)tx_pin;
+  gps_on_receive = on_receive;
+  gps_buffer_size = buffer_size < sizeof(gps_buffer) ? buffer_size : sizeof(gps_buffer);
+
+  if (gps_fd < 0)
+  {
+    const char *device = getenv("GPS_DEVICE");
+    if (device == 0)
+    {
+      fprintf(stderr, "No GPS_DEVICE, running without GPS\n");
+      return;
+    }
+    gps_fd = open(device, O_RDWR | O_NOCTTY | O_NONBLOCK);
+    if (gps_fd < 0)
+    {
+      perror(device);
+      return;
+    }
+    // A FIFO would hand the configuration commands back to us
+    gps_is_tty = isatty(gps_fd);
+  }
+
+  // A serial port follows the baud rate changes of the configuration
+  struct termios tty;
+  if (tcgetattr(gps_fd, &tty) == 0)
+  {
+    cfmakeraw(&tty);
+    cfsetspeed(&tty, baud_to_speed(baud));
+    tcsetattr(gps_fd, TCSANOW, &tty);
+  }
+}
+
+void hal_gps_end()
+{
+  gps_buffered = 0;
+}
+
+size_t hal_gps_available()
+{
+  if (gps_fd >= 0 && gps_buffered < gps_buffer_size)
+  {
+    ssize_t len = read(gps_fd, gps_buffer + gps_buffered, gps_buffer_size - gps_buffered);
+    if (len > 0)
+    {
+      gps_buffered += len;
+      gps_overflowed = gps_overflowed || gps_buffered == gps_buffer_size;
+    }
+    else if (len == 0)
+    {
+      // End of a file
+      fprintf(stderr, "GPS input ended\n");
+      close(gps_fd);
+      gps_fd = -1;
+    }
+  }
+  return gps_buffered;
+}
+
+size_t hal_gps_read(uint8_t *buffer, size_t len)
+{
+  if (len > gps_buffered)
+  {
+    len = gps_buffered;
+  }
+  memcpy(buffer, gps_buffer, len);
+  memmove(gps_buffer, gps_buffer + len, gps_buffered - len);
+  gps_buffered -= len;
+  return len;
+}
+
+size_t hal_gps_write(const uint8_t *data, size_t len)
+{
+  if (!gps_is_tty)
+  {
+    return len;
+  }
+  return gps_fd >= 0 && write(gps_fd, data, len) > 0 ? len : 0;
+}
+
+bool hal_gps_overflow()
+{
+  bool overflowed = gps_overflowed;
+  gps_overflowed = false;
+  return overflowed;
+}
+
+
+/**********************************************
+ * Display: print the digits when they change
+ **********************************************/
+void display_begin(uint8_t data_pin, uint8_t latch_pin, uint8_t clock_pin)
+{
+  (void)data_pin;
+  (void)latch_pin;
+  (void)clock_pin;
+}
+
+void display_write(uint32_t frame)
+{
+  static char shown[6] = "";
+  char text[6];
+
+  frame_text(frame, text);
+  text[2] = ':'; // not every blink of the dot
+  if (strchr(text, '?') == 0 && strcmp(text, shown) != 0)
+  {
+    strcpy(shown, text);
+    fprintf(stderr, "Digits: %s\n", text);
+  }
+}
+
+
+/**********************************************
+ * Persistent store: a file that behaves like NOR flash
+ **********************************************/
+static bool save_sector()
+{
+  FILE *file = fopen(STORE_FILE, "wb");
+  if (file == 0)
+  {
+    return false;
+  }
+  bool ok = fwrite(sector, 1, sizeof(sector), file) == sizeof(sector);
+  return fclose(file) == 0 && ok;
+}
+
+static void load_sector()
+{
+  if (sector_loaded)
+  {
+    return;
+  }
+  sector_loaded = true;
+
+  memset(sector, 0xFF, sizeof(sector));
+  FILE *file = fopen(STORE_FILE, "rb");
+  if (file != 0)
+  {
+    if (fread(sector, 1, sizeof(sector), file) != sizeof(sector))
+    {
+      memset(sector, 0xFF, sizeof(sector));
+    }
+    fclose(file);
+  }
+}
+
+bool hal_store_read(uint16_t offset, uint32_t *data, uint16_t len)
+{
+  load_sector();
+  memcpy(data, sector + offset, len);
+  return true;
+}
+
+bool hal_store_write(uint16_t offset, const uint32_t *data, uint16_t len)
+{
+  load_sector();
+
+  // Programming can only clear bits
+  const uint8_t *bytes = (const uint8_t *)data;
+  for (uint16_t i = 0; i < len; i++)
+  {
+    sector[offset + i] &= bytes[i];
+  }
+  return save_sector();
+}
+
+bool hal_store_erase()
+{
+  sector_loaded = true;
+  memset(sector, 0xFF, sizeof(sector));
+  return save_sector();
+}
+
+#endif // !ARDUINO
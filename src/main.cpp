@@ -5,41 +5,48 @@
  * Edited: 02.03.2025
  * Tauno Erik
  * 
- * PPS -
+ * PPS - D1 (GPIO5)
  * RXD -
  * TXD -
  * GND - GND
  * VCC - 3.3V
  * 
- * SDA - GPIO4 (ESP8266 - D2)
- * SCL - GPIO5 (ESP8266 - D1)
- * 
- * 
  */
-#include <Arduino.h>
-#include <SoftwareSerial.h>
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
 #include <TinyGPSPlus.h>    // https://github.com/mikalhart/TinyGPSPlus/tree/master/examples
-#include <EEPROM.h>
-
-// A struct to store date and time
-struct DateTime {
-  int year;
-  int month;
-  int day;
-  int hour;
-  int minute;
-  int second;
-};
+#include <TinyGPSUbx.h>
+#include "hal.h"
+#include "date_time.h"
+#include "pps_clock.h"
+#include "disciplined_clock.h"
+#include "scheduler.h"
+#include "display.h"
+#include "frame.h"
+#include "gps_uart.h"
+#include "gps_config.h"
+#include "console.h"
+#include "settings_store.h"
+#include "time_zone.h"
+#include "stats.h"
+#include "recorder.h"
 
 DateTime UTC_time;    // Instance for the UTC time
 DateTime local_time;  // Instance for the local time
 
+// Layout version of the Settings struct in the settings store
+#define SETTINGS_VERSION 2
+
 // A Struct to store settings
 struct Settings {
   int time_zone_offset;
   bool is_summer_time; // or summer_time and wintter_time
+  char time_zone[TZ_RULE_SIZE]; // POSIX TZ rule, if empty the two above are used
 };
 
+static_assert(sizeof(Settings) <= SETTINGS_STORE_MAX_SIZE, "Settings don't fit in a record");
+
 // Create an instance of the Settings struct
 Settings settings;
 
@@ -48,15 +55,30 @@ Settings settings;
 // Example: UTC+2 (Central European Time)
 const Settings default_settings = {
   .time_zone_offset = 2,    // Default time zone offset (UTC)
-  .is_summer_time = false // Default daylight saving (disabled)
+  .is_summer_time = false, // Default daylight saving (disabled)
+  .time_zone = "EET-2EEST,M3.5.0/3,M10.5.0/4" // Estonia, with the EU summer time
 };
 
+// The time zone of the settings
+TimeZone time_zone;
+
 enum USER_COMMANDS
 {
   RAW = 0,
   CLOCK = 1,
   OFFSET = 2,
   DAYLIGHT = 3,
+  TIME_ZONE = 4,
+};
+
+// Scheduler events
+enum EVENTS
+{
+  EVENT_PPS = 0,         // PPS pulse captured
+  EVENT_UART_DATA = 1,   // Data from the GPS module
+  EVENT_TIME_COMMIT = 2, // GPS date and time received
+  EVENT_SECOND = 3,      // New second of the local clock
+  EVENT_COMMAND = 4,     // Input on the Serial port
 };
 
 #define PRINT_DATE_TIME 0
@@ -65,216 +87,511 @@ enum USER_COMMANDS
 #define DOT_TOGGLE_TIME    500
 #define CLOCK_UPDATE_TIME 1000
 
+#define OVERLAY_STEP_TIME  100
+
+// How often the recorded GPS input is written to the file
+#define RECORDER_FLUSH_TIME 500
+
+// How often the receiver configuration checks for acknowledgements
+#define GPS_CONFIG_POLL_TIME 20
+
+// Longest idle time in ms, the GPS serial buffer must not fill up meanwhile
+#define MAX_IDLE_TIME 20
+
+// Local clock steering
+// PPS is read within a few microseconds of the pulse.
+// RMC/NAV-TIMEUTC arrive some time after the second they describe; the
+// delay is mostly constant, its jitter is what matters for the frequency
+// estimate. ZDA and NAV-TIMEUTC tell the same second at different delays,
+// so only one of them steers.
+#define PPS_SYNC_UNCERTAINTY_US     10
+#define NMEA_LATENCY_US         150000
+#define NMEA_SYNC_UNCERTAINTY_US 20000
+
 // 115200 bps: The default baud rate for most ESP8266
 // 230400 bps: A good compromise between speed and reliability
 // 460800 bps: Suitable for high-speed communication with minimal errors
 // 921600 bps: The highest commonly used baud rate for reliable communication
 static const int BAUD_RATE = 115200;
 
-// Shift Register 74HC595 pins
-static const int DATA_PIN  = D4;
-static const int LATCH_PIN = D3;
-static const int CLOCK_PIN = D2;
+// Shift Register 74HC595 pins, GPIO numbers of the D1 mini pins
+static const int DATA_PIN  = 2; // D4
+static const int LATCH_PIN = 0; // D3
+static const int CLOCK_PIN = 4; // D2
 
 // GPS module pins
-static const int  RX_PIN = D7;
-static const int  TX_PIN = D8;
+static const int  RX_PIN = 13; // D7
+static const int  TX_PIN = 15; // D8
+static const int PPS_PIN = 5;  // D1
 
+// GY-NEO6MV2 factory default
 static const uint32_t GPSBaud = 9600;
 
 
-// Lookup table for digits 0-9
-// MSBFIRST
-// 0 - ON, 1 - OFF
-const uint8_t digits[10] = {
-  0b00000011, // 0
-  0b10011111, // 1
-  0b00100101, // 2
-  0b00001101, // 3
-  0b10011001, // 4
-  0b01001001, // 5
-  0b11000001, // 6
-  0b00011111, // 7
-  0b00000001, // 8
-  0b00001001  // 9
-};
+TinyGPSPlus gps;
+TinyGPSUbx ubx(gps); // UBX replies, the NMEA sentences go on to gps
 
-uint32_t numbers_data = 0;
-uint32_t display_data = 0; // liidetud
-
-uint8_t hour_minut_dot_pos = 16;
-uint32_t dot_bitmask = 1 << hour_minut_dot_pos;
-
-// 7-segment led bits
-const uint8_t  a = 0b01111111;
-const uint8_t  b = 0b10111111;
-const uint8_t  c = 0b11011111;
-const uint8_t  d = 0b11101111;
-const uint8_t  e = 0b11110111;
-const uint8_t  f = 0b11111011;
-const uint8_t  g = 0b11111101;
-const uint8_t dp = 0b11111110;
-
-/*
-int overlay_delay = 100; // Pausi aeg millisekundites
-unsigned long overlay_prev_millis = 0; // Eelmise mustri kuvamise aeg
-int overlay_current_index = 0; // Praeguse mustri indeks
-
-const uint32_t overlay_patterns[] = {
-    0b11111111111111111111111101111111,
-    0b11111111111111110111111111111111,
-    0b11111111011111111111111111111111,
-    0b01111111111111111111111111111111,
-    0b11111011111111111111111111111111,
-    0b11110111111111111111111111111111,
-    0b11101111111111111111111111111111,
-    0b11111111111011111111111111111111,
-    0b11111111111111111110111111111111,
-    0b11111111111111111111111111101111,
-    0b11111111111111111111111111011111,
-    0b11111111111111111111111110111111
-};
+int user_cmd = CLOCK; // User command to execute
 
-const int num_overlay_patterns = sizeof(overlay_patterns) / sizeof(overlay_patterns[0]);
-*/
+int8_t dot_timer;    // Toggles the dot
+int8_t second_timer; // Wakes up at the start of the next second
+int8_t overlay_timer; // Animation while waiting for the GPS time
+int8_t config_timer;  // Receiver configuration at startup
+int8_t record_timer;  // Writes the recorded GPS input to the file
 
-TinyGPSPlus gps;
-
-// The serial connection to the GPS device
-SoftwareSerial GPS_Serial(RX_PIN, TX_PIN);
+int64_t shown_seconds = 0; // UTC second on the display
 
 /**********************************************
  * Function prototypes
  **********************************************/
 void print_date_time(const DateTime &dt);
-bool update_date_time(DateTime &dt);
-void local_date_time(DateTime &dt);
-void write_to_display(uint32_t data);
+void local_date_time(int64_t seconds, DateTime &dt);
+void update_clock(int64_t seconds, int user_cmd);
+void schedule_second();
+void poll_event_sources();
+void on_pps();
+void on_uart_data();
+void on_time_commit();
+void on_second_timer();
+void on_second();
+void on_dot_toggle();
+void on_overlay_step();
+void on_gps_config();
+void on_record_flush();
+void record_gps_data(const uint8_t *data, size_t len);
+void on_command();
 void run_gps(int print);
 void print_serial_cmds();
+void cmd_raw(uint8_t argc, const char *argv[]);
+void cmd_clock(uint8_t argc, const char *argv[]);
+void cmd_offset(uint8_t argc, const char *argv[]);
+void cmd_daylight(uint8_t argc, const char *argv[]);
+void cmd_tz(uint8_t argc, const char *argv[]);
+void cmd_stats(uint8_t argc, const char *argv[]);
+void cmd_rec(uint8_t argc, const char *argv[]);
+void cmd_help(uint8_t argc, const char *argv[]);
 
 void load_settings();
 void save_settings();
 void print_settings();
-
-int get_user_serial_input();
+void apply_time_zone();
+void print_histogram(const char *name, uint8_t histogram);
+
+static_assert(STATS_SENTENCE_TYPES == TinyGPSPlus::GPS_SENTENCE_TYPES, "Sentence types of the stats dump");
+
+// Serial console commands
+static const ConsoleCommand commands[] = {
+  {"RAW",      cmd_raw,      "Print raw GPS data"},
+  {"CLOCK",    cmd_clock,    "Print GPS date and time"},
+  {"OFFSET",   cmd_offset,   "Set the time zone offset (e.g., OFFSET+2)"},
+  {"DAYLIGHT", cmd_daylight, "Enable or disable daylight saving (DAYLIGHTON, DAYLIGHTOFF)"},
+  {"TZ",       cmd_tz,       "Set the time zone rule (e.g., TZ EET-2EEST,M3.5.0/3,M10.5.0/4)"},
+  {"STATS",    cmd_stats,    "Print timing statistics (STATS, STATS BIN, STATS RESET)"},
+  {"REC",      cmd_rec,      "Record the GPS input (REC START [file], REC STOP, REC DUMP [file])"},
+  {"HELP",     cmd_help,     "Print the available commands"},
+};
 
 /*********************************************/
 void setup() {
-  Serial.begin(BAUD_RATE);
-  GPS_Serial.begin(GPSBaud);
+  hal_console_begin(BAUD_RATE);
+  gps_uart_begin(RX_PIN, TX_PIN, GPSBaud);
+  gps_uart_set_tap(record_gps_data);
 
   // Initialize the shift register pins
-  pinMode(DATA_PIN, OUTPUT);
-  pinMode(LATCH_PIN, OUTPUT);
-  pinMode(CLOCK_PIN, OUTPUT);
+  display_begin(DATA_PIN, LATCH_PIN, CLOCK_PIN);
 
-  // Initialize EEPROM with 4096 bytes (max size for ESP8266)
-  EEPROM.begin(4096);
+  // Timestamp the GPS second pulses
+  pps_begin(PPS_PIN);
 
-  // Load settings from EEPROM
+  // Load settings from flash
   load_settings();
   print_settings();
+
+  console_begin(commands, sizeof(commands) / sizeof(commands[0]));
+
+  // The clock doesn't use WiFi; with the modem off the chip idles in delay()
+  hal_radio_off();
+
+  // Event handlers and timers
+  uint32_t now_ms = hal_millis();
+  sched_on(EVENT_PPS, on_pps);
+  sched_on(EVENT_UART_DATA, on_uart_data);
+  sched_on(EVENT_TIME_COMMIT, on_time_commit);
+  sched_on(EVENT_SECOND, on_second);
+  sched_on(EVENT_COMMAND, on_command);
+  dot_timer = sched_timer(now_ms, DOT_TOGGLE_TIME, on_dot_toggle);
+  second_timer = sched_timeout(now_ms, CLOCK_UPDATE_TIME, on_second_timer);
+  overlay_timer = sched_timeout(now_ms, OVERLAY_STEP_TIME, on_overlay_step);
+  config_timer = sched_timeout(now_ms, GPS_CONFIG_POLL_TIME, on_gps_config);
+  record_timer = sched_timeout(now_ms, RECORDER_FLUSH_TIME, on_record_flush);
+
+  // Only the needed sentences, at a higher baud rate
+  gps_config_begin(ubx, gps_uart_write, gps_uart_set_baud, GPSBaud, now_ms);
 }
 
 void loop()
 {
-  unsigned long current_millis = millis();
-  static unsigned long prev_millis = 0;
-  static unsigned long prev_dot_millis = 0;
+  uint32_t start_us = hal_micros();
 
-  static int user_cmd =  CLOCK; // User command to execute
+  poll_event_sources();
 
-  static uint8_t h1 = 0; // for displaying hours and minutes
-  static uint8_t h2 = 0;
-  static uint8_t m1 = 0;
-  static uint8_t m2 = 0;
+  uint32_t idle_ms = sched_dispatch(hal_millis());
+  stats_add(STATS_LOOP, hal_micros() - start_us);
 
-  // Check if data is available on the Serial port
-  if (Serial.available() > 0)
+  // Nothing to do, idle until the next timer
+  if (idle_ms > 0)
   {
-    user_cmd = get_user_serial_input();
+    hal_delay(idle_ms < MAX_IDLE_TIME ? idle_ms : MAX_IDLE_TIME);
   }
+} // loop end
 
 
+/**
+ * Post events for the inputs that have something new
+ */
+void poll_event_sources()
+{
+  static uint32_t prev_pulse_count = 0;
+
+  uint32_t pulse_count = pps_pulse_count();
+  if (pulse_count != prev_pulse_count)
+  {
+    prev_pulse_count = pulse_count;
+    sched_post(EVENT_PPS);
+  }
+
+  if (gps_uart_available() > 0)
+  {
+    sched_post(EVENT_UART_DATA);
+  }
+
+  if (hal_console_available() > 0)
+  {
+    sched_post(EVENT_COMMAND);
+  }
+}
+
+
+/**
+ * PPS pulse: steer the local clock
+ */
+void on_pps()
+{
+  uint64_t now_us = hal_micros64();
+  Epoch now;
+
+  recorder_pps(hal_micros() - pps_edge_age_us());
+
+  if (pps_now(now))
+  {
+    dclock_sync(now_us, now, PPS_SYNC_UNCERTAINTY_US);
+    schedule_second();
+  }
+}
+
+
+/**
+ * Data from the GPS module
+ */
+void on_uart_data()
+{
+  static uint32_t prev_lost = 0;
+
+  stats_bytes(gps_uart_received(), hal_millis());
+
+  uint32_t lost = gps_uart_dropped() + gps_uart_overflows();
+  if (lost != prev_lost)
+  {
+    prev_lost = lost;
+    Console.print("GPS serial overflow! Dropped bytes: ");
+    Console.print(gps_uart_dropped());
+    Console.print(", receiver overflows: ");
+    Console.print(gps_uart_overflows());
+    Console.print(", high water: ");
+    Console.println(gps_uart_high_water());
+  }
+
   // Select with data to serial print
   switch (user_cmd)
   {
     case RAW:
       run_gps(PRINT_RAW_GPS);
       break;
-  
-    case CLOCK:
-    case OFFSET:
-    case DAYLIGHT:
-      run_gps(PRINT_DATE_TIME);
-      break;
 
     default:
+      run_gps(PRINT_DATE_TIME);
       break;
   }
+}
 
-  //////////
-  /*
-  if (current_millis - overlay_prev_millis >= overlay_delay) {
-    overlay_prev_millis = current_millis;
 
-    // merge
-    //display_data = numbers_data & overlay_patterns[overlay_current_index];
-    //write_to_display(display_data);
-    write_to_display(numbers_data);
+/**
+ * GPS date and time received (RMC, ZDA or NAV-TIMEUTC)
+ */
+void on_time_commit()
+{
+  uint64_t now_us = hal_micros64();
+  TinyGPSDateTime gps_time = gps.dateTime(); // One consistent copy
+  uint8_t centisecond = gps_time.centisecond;
+  DateTime dt;
+  dt.year = gps_time.year;
+  dt.month = gps_time.month;
+  dt.day = gps_time.day;
+  dt.hour = gps_time.hour;
+  dt.minute = gps_time.minute;
+  dt.second = gps_time.second;
+
+  // Pair the time with the last PPS pulse
+  int64_t seconds = date_time_to_epoch(dt);
+  pps_set_time(seconds, centisecond);
+
+  // More than one message may tell the same second
+  static int64_t prev_seconds = 0;
+  bool new_second = seconds != prev_seconds;
+  prev_seconds = seconds;
+  if (new_second)
+  {
+    stats_second((uint32_t)now_us);
+  }
 
-    overlay_current_index++;
-    if (overlay_current_index >= num_overlay_patterns) {
-      overlay_current_index = 0;
-    }
+  // NAV-TIMEUTC while it arrives, else the first NMEA sentence of the second
+  static int64_t ubx_seconds = 0;
+  static int64_t steered_seconds = 0;
+  if (gps_time.ubx)
+  {
+    ubx_seconds = seconds;
   }
-    */
+  bool steer = seconds != steered_seconds && (gps_time.ubx || seconds - ubx_seconds > 2);
 
-  // Time to toggle the dot
-  if (current_millis - prev_dot_millis >= DOT_TOGGLE_TIME)
+  // Without PPS the sentence itself steers the local clock
+  Epoch pps_time;
+  if (pps_now(pps_time))
   {
-    prev_dot_millis = current_millis;
-    numbers_data ^= dot_bitmask; // Toggle the dot
-    write_to_display(numbers_data);
+    if (new_second)
+    {
+      stats_add(STATS_PPS_LATENCY, pps_time.micros);
+    }
   }
+  else if (steer)
+  {
+    steered_seconds = seconds;
+    // The sentence was received some time after the time it tells
+    uint32_t micros = centisecond * 10000UL + NMEA_LATENCY_US;
+    Epoch received;
+    received.seconds = seconds + micros / 1000000;
+    received.micros = micros % 1000000;
+    dclock_sync(now_us, received, NMEA_SYNC_UNCERTAINTY_US);
+    schedule_second();
+  }
+}
 
-  // Time to update the Clock
-  if (current_millis - prev_millis >= CLOCK_UPDATE_TIME)
+
+/**
+ * Arm the second timer for the start of the next second
+ */
+void schedule_second()
+{
+  Epoch now;
+  uint32_t delay_ms = CLOCK_UPDATE_TIME;
+
+  if (dclock_now(hal_micros64(), now))
   {
-    prev_millis = current_millis;
-    // Update the struct with the current GPS UTC date and time
-    bool no_time = update_date_time(UTC_time);
-    no_time = update_date_time(local_time); // still UTC time
+    // A pulse handled just after the boundary must not push the second
+    // timer that was about to show it into the next second
+    if (now.seconds != shown_seconds)
+    {
+      sched_post(EVENT_SECOND);
+    }
+
+    // Round up, so that the timer fires just after the boundary
+    delay_ms = (1000000UL - now.micros) / 1000 + 1;
+  }
+
+  sched_restart(second_timer, hal_millis(), delay_ms);
+}
+
+
+void on_second_timer()
+{
+  sched_post(EVENT_SECOND);
+}
+
 
-    if (no_time)
+/**
+ * New second: update the Clock
+ */
+void on_second()
+{
+  Epoch now;
+
+  if (dclock_now(hal_micros64(), now))
+  {
+    if (now.seconds != shown_seconds)
     {
-      Serial.println("1 Waiting for valid GPS date and time");
+      shown_seconds = now.seconds;
+
+      // Blink in step with the seconds
+      sched_restart(dot_timer, hal_millis(), DOT_TOGGLE_TIME);
+
+      epoch_to_date_time(now.seconds, UTC_time);
+      update_clock(now.seconds, user_cmd);
     }
+  }
+  else
+  {
+    Console.println("Waiting for valid GPS date and time");
+  }
+
+  schedule_second();
+}
+
+
+/**
+ * Spin the overlay animation until there is a time to show
+ */
+void on_overlay_step()
+{
+  Epoch now;
+
+  if (dclock_now(hal_micros64(), now))
+  {
+    frame_set_overlay(FRAME_NO_OVERLAY);
+  }
+  else
+  {
+    frame_overlay_step();
+    sched_restart(overlay_timer, hal_millis(), OVERLAY_STEP_TIME);
+  }
+
+  frame_flush();
+}
+
+
+/**
+ * Drive the receiver configuration until it is done
+ */
+void on_gps_config()
+{
+  uint8_t state = gps_config_update(hal_millis());
+
+  if (state == GPS_CONFIG_BUSY)
+  {
+    sched_restart(config_timer, hal_millis(), GPS_CONFIG_POLL_TIME);
+    return;
+  }
 
-    local_date_time(local_time);
+  Console.print(state == GPS_CONFIG_DONE ? "GPS configured" : "GPS configuration failed");
+  Console.print(", accepted ");
+  Console.print(gps_config_acked());
+  Console.print(", rejected ");
+  Console.print(gps_config_nakked());
+  Console.print(", baud ");
+  Console.println(gps_config_baud());
+}
 
-    // 8-bit numbers to display on the 7-segment display
-    h1 = local_time.hour / 10;
-    h2 = local_time.hour % 10;
-    m1 = local_time.minute / 10;
-    m2 = local_time.minute % 10;
-    
-    // 32-bit number to display on the 7-segment display
-    numbers_data = digits[h1] << 24 | digits[h2] << 16 | digits[m1] << 8 | digits[m2];
-    
-    write_to_display(numbers_data);
 
-    if (user_cmd != RAW)
+/**
+ * Write the recorded GPS input to the file while recording
+ */
+void on_record_flush()
+{
+  if (!recorder_active())
+  {
+    return;
+  }
+
+  if (recorder_flush())
+  {
+    sched_restart(record_timer, hal_millis(), RECORDER_FLUSH_TIME);
+    return;
+  }
+
+  Console.print("Recording stopped, the file is full: ");
+  Console.print(recorder_file_size());
+  Console.println(" bytes");
+}
+
+
+/**
+ * Bytes from the GPS module, as they arrive
+ */
+void record_gps_data(const uint8_t *data, size_t len)
+{
+  recorder_data(hal_micros(), data, len);
+}
+
+
+/**
+ * Time to toggle the dot
+ */
+void on_dot_toggle()
+{
+  frame_toggle_dot();
+  frame_flush();
+}
+
+
+/**
+ * Input on the Serial port: take what has arrived, without waiting
+ * for the rest of the line
+ */
+void on_command()
+{
+  while (hal_console_available() > 0)
+  {
+    switch (console_feed((char)hal_console_read()))
     {
-      Serial.print("UTC Time: ");
-      print_date_time(UTC_time);
-      Serial.print("My Time:  ");
-      print_date_time(local_time);
+      case CONSOLE_UNKNOWN:
+        Console.print("Unknown command: ");
+        Console.println(console_line());
+        print_serial_cmds();
+        break;
+
+      case CONSOLE_OVERFLOW:
+        Console.println("Command too long");
+        break;
+
+      default:
+        break;
     }
   }
+}
 
-} // loop end
+
+/**
+ * Function to show the local time of UTC_time on the display
+ * @param seconds: UTC_time as seconds since 2000
+ * @param user_cmd: the active user command
+ */
+void update_clock(int64_t seconds, int user_cmd)
+{
+  local_date_time(seconds, local_time);
+
+  // The dot blinks off at the start of the second
+  frame_set_time(local_time.hour, local_time.minute);
+  frame_set_dot(false);
+  frame_flush();
+
+  if (user_cmd != RAW)
+  {
+    Console.print("UTC Time: ");
+    print_date_time(UTC_time);
+    Console.print("My Time:  ");
+    Console.print(tz_name(time_zone));
+    Console.print(" ");
+    print_date_time(local_time);
+
+    uint64_t now_us = hal_micros64();
+    if (dclock_is_holdover(now_us))
+    {
+      Console.print("Holdover, error +-");
+      Console.print(dclock_error_us(now_us) / 1000);
+      Console.print(" ms, drift ");
+      Console.print(dclock_drift_ppb());
+      Console.println(" ppb");
+    }
+  }
+}
 
 
 
@@ -284,13 +601,30 @@ void loop()
  ******************************************************************/
 void run_gps(int print = 0)
 {
-  while (GPS_Serial.available())
+  static uint32_t time_sequence = 0; // Last date and time commit seen
+  char buffer[128]; // Drain the GPS ring buffer in batches
+  size_t len;
+
+  while ((len = gps_uart_read(buffer, sizeof(buffer))) > 0)
   {
-    uint8_t gps_data = GPS_Serial.read();
-    gps.encode(gps_data);
+    // One sample per read, the last sentence in it. The time includes
+    // the reception of the part that came in an earlier read, so it is
+    // the parse time only when the whole sentence is in this one.
+    if (ubx.encode(buffer, len) > 0)
+    {
+      stats_add(STATS_SENTENCE, gps.sentenceTime());
+    }
+
+    // RMC, ZDA and NAV-TIMEUTC commit date and time together
+    if (gps.dateTime().sequence != time_sequence)
+    {
+      time_sequence = gps.dateTime().sequence;
+      sched_post(EVENT_TIME_COMMIT);
+    }
+
     if (print == PRINT_RAW_GPS)
     {
-      Serial.write(gps_data);
+      Console.write((const uint8_t *)buffer, len);
     }
   }
 }
@@ -302,207 +636,371 @@ void run_gps(int print = 0)
  */
 void print_date_time(const DateTime &dt)
 {
-  char buffer[20];  // Buffer to store the formatted string
-  // Make sure the buffer is large enough to hold the final string
+  char buffer[28];  // Buffer to store the formatted string
+  // Large enough for any field value: "255:255:255 255/255/-32768"
 
-  sprintf(buffer, "%02d:%02d:%02d %02d/%02d/%02d",
+  snprintf(buffer, sizeof(buffer), "%02d:%02d:%02d %02d/%02d/%02d",
           dt.hour, dt.minute, dt.second, dt.day, dt.month, dt.year);
 
-  Serial.println(buffer);
+  Console.println(buffer);
 }
 
 
 /**
- * Function to update the struct with the current GPS date and time
- * @param dt: DateTime struct to store the date and time
- * @return true if the date and time are valid; otherwise, false
+ * Function to calculate local date and time
+ * @param seconds: UTC, seconds since 2000
+ * @param dt: DateTime struct to store the local date and time
  */
-bool update_date_time(DateTime &dt)
+void local_date_time(int64_t seconds, DateTime &dt)
 {
-  if (gps.date.isValid() && gps.time.isValid())
+  // The time zone rule knows when summer time begins and ends, e.g. in
+  // the EU on the last Sunday of March and October at 01:00 UTC
+  tz_local(time_zone, seconds, dt);
+}
+
+
+/**
+ * Set up the time zone from the settings: the TZ rule, or the fixed
+ * offset and the manual daylight saving hour
+ */
+void apply_time_zone()
+{
+  settings.time_zone[TZ_RULE_SIZE - 1] = '\0';
+
+  if (settings.time_zone[0] == '\0' || !tz_parse(time_zone, settings.time_zone))
   {
-    dt.year = gps.date.year();
-    dt.month = gps.date.month();
-    dt.day = gps.date.day();
-    dt.hour = gps.time.hour();
-    dt.minute = gps.time.minute();
-    dt.second = gps.time.second();
+    tz_fixed(time_zone, (settings.time_zone_offset + settings.is_summer_time) * 3600L);
   }
-  else
+}
+
+
+/**
+ * Function to print the available serial commands
+ */
+void print_serial_cmds()
+{
+  Console.println("Available commands:");
+  for (const ConsoleCommand &cmd : commands)
   {
-    return false;
+    Console.print("\t");
+    Console.print(cmd.name);
+    Console.print(": ");
+    Console.println(cmd.help);
   }
+}
+
 
-  return true;
+/**
+ * RAW: print the raw GPS data
+ */
+void cmd_raw(uint8_t argc, const char *argv[])
+{
+  (void)argc;
+  (void)argv;
+  user_cmd = RAW;
 }
 
 
 /**
- * Function to calculate local date and time
- * @param dt: DateTime struct with UTC date and time
+ * CLOCK: print the GPS date and time
  */
-void local_date_time(DateTime &dt)
+void cmd_clock(uint8_t argc, const char *argv[])
 {
-  // Calculate local time by applying the time zone offset
-  dt.hour += settings.time_zone_offset;
+  (void)argc;
+  (void)argv;
+  user_cmd = CLOCK;
+}
 
-  // TODU: Handle daylight saving time
-  // Get the current month and day
-  // Suveaeg on vööndiajast ühe tunni võrra edasi nihutatud kellaaeg.
-  // Suveajale minnakse Euroopas märtsi viimasel pühapäeval 
-  // kell 01:00 UTC (Eestis 3:00) ja tagasi vööndiajale minnakse oktoobri 
-  // viimasel pühapäeval kell 01:00 UTC
 
-  if (settings.is_summer_time)
+/**
+ * OFFSET: set the time zone offset in hours, e.g. OFFSET+2 or OFFSET -3
+ */
+void cmd_offset(uint8_t argc, const char *argv[])
+{
+  int32_t offset;
+
+  if (argc < 2 || !console_parse_int(argv[1], offset) || offset < -12 || offset > 14)
   {
-    // Add 1 hour for daylight saving time
-    dt.hour += 1;
+    Console.println("Usage: OFFSET<-12..+14>");
+    return;
   }
 
-  // Handle overflow (e.g., if localHour >= 24)
-  if (dt.hour >= 24)
+  settings.time_zone_offset = offset; // Update the time zone offset
+  settings.time_zone[0] = '\0';       // The offset replaces the TZ rule
+  apply_time_zone();
+  save_settings();                    // Save the settings to flash
+  user_cmd = OFFSET;
+}
+
+
+/**
+ * DAYLIGHT: enable or disable daylight saving, DAYLIGHTON or DAYLIGHT OFF
+ */
+void cmd_daylight(uint8_t argc, const char *argv[])
+{
+  if (argc < 2 || (strcasecmp(argv[1], "ON") != 0 && strcasecmp(argv[1], "OFF") != 0))
   {
-    dt.hour -= 24;
-    dt.day += 1;  // Increment the day
+    Console.println("Usage: DAYLIGHTON or DAYLIGHTOFF");
+    return;
   }
-  else if (dt.hour < 0)
+
+  settings.is_summer_time = strcasecmp(argv[1], "ON") == 0; // Update the daylight saving setting
+  settings.time_zone[0] = '\0';                               // Manual daylight saving replaces the TZ rule
+  apply_time_zone();
+  save_settings();                                            // Save the settings to flash
+  user_cmd = DAYLIGHT;
+}
+
+
+/**
+ * TZ: set the time zone as a POSIX TZ rule, e.g. TZ CET-1CEST,M3.5.0,M10.5.0/3
+ */
+void cmd_tz(uint8_t argc, const char *argv[])
+{
+  if (argc < 2 || strlen(argv[1]) >= TZ_RULE_SIZE || !tz_parse(time_zone, argv[1]))
   {
-    dt.hour += 24;
-    dt.day -= 1;  // Decrement the day
+    Console.println("Usage: TZ <POSIX TZ rule>, e.g. TZ EET-2EEST,M3.5.0/3,M10.5.0/4");
+    return;
   }
+
+  strcpy(settings.time_zone, argv[1]);
+  save_settings();
+  user_cmd = TIME_ZONE;
 }
 
 
 /**
- * Function to write data to the shift register
- * @param data: 32-bit data to write to the shift register
+ * STATS: print the statistics, STATS BIN sends them as a binary
+ * StatsDump record, STATS RESET clears them
  */
-void write_to_display(uint32_t data)
+void cmd_stats(uint8_t argc, const char *argv[])
 {
-  uint8_t bit_order = MSBFIRST; // MSBFIRST; // Most significant bit first
-  int size = 32; // 8 bits * 4 shift registers
-
-  digitalWrite(LATCH_PIN, LOW);
+  if (argc >= 2 && strcasecmp(argv[1], "RESET") == 0)
+  {
+    stats_reset();
+    return;
+  }
 
-  for (int i = 0; i < size; i++)
+  if (argc >= 2 && strcasecmp(argv[1], "BIN") == 0)
   {
-    if (bit_order == LSBFIRST)
-    {
-      digitalWrite(DATA_PIN, data & 1); // Send the least significant bit
-      data >>= 1; // Shift right to get the next bit
-    }
-    else // MSBFIRST
+    StatsDump dump;
+    stats_fill_dump(dump);
+    dump.uptime_ms = hal_millis();
+    dump.chars = gps.charsProcessed();
+    dump.passed = gps.passedChecksum();
+    dump.failed = gps.failedChecksum();
+    dump.with_fix = gps.sentencesWithFix();
+    for (uint8_t i = 0; i < STATS_SENTENCE_TYPES; i++)
     {
-      digitalWrite(DATA_PIN, (data & 0x80000000) ? HIGH : LOW); // Send the most significant bit
-      data <<= 1; // Shift left to get the next bit
+      dump.sentences[i] = gps.sentenceCount(i);
     }
-
-    // Pulse the clock pin to shift the bit into the 74HC595
-    digitalWrite(CLOCK_PIN, HIGH);
-    digitalWrite(CLOCK_PIN, LOW);
+    dump.ubx_frames = ubx.framesProcessed();
+    dump.ubx_failed = ubx.failedChecksum();
+    dump.uart_received = gps_uart_received();
+    dump.uart_dropped = gps_uart_dropped();
+    dump.uart_overflows = gps_uart_overflows();
+    dump.uart_high_water = gps_uart_high_water();
+    dump.frames_pushed = frame_pushed_count();
+    dump.frames_skipped = frame_skipped_count();
+    Console.write((const uint8_t *)&dump, sizeof(dump));
+    return;
   }
 
-  digitalWrite(LATCH_PIN, HIGH);
+  Console.println("Sentences:");
+  for (uint8_t i = 0; i < STATS_SENTENCE_TYPES; i++)
+  {
+    Console.print("\t");
+    Console.print(TinyGPSPlus::sentenceTypeName(i));
+    Console.print(": ");
+    Console.println(gps.sentenceCount(i));
+  }
+  Console.print("\tUBX: ");
+  Console.println(ubx.framesProcessed());
+  Console.print("Checksum failed: NMEA ");
+  Console.print(gps.failedChecksum());
+  Console.print(", UBX ");
+  Console.println(ubx.failedChecksum());
+  Console.print("GPS data: ");
+  Console.print(stats_bytes_per_second());
+  Console.print(" bytes/s (max ");
+  Console.print(stats_max_bytes_per_second());
+  Console.print("), dropped ");
+  Console.print(gps_uart_dropped());
+  Console.print(", overflows ");
+  Console.print(gps_uart_overflows());
+  Console.print(", high water ");
+  Console.println(gps_uart_high_water());
+  Console.print("Display: ");
+  Console.print(frame_pushed_count());
+  Console.print(" frames shifted out, ");
+  Console.print(frame_skipped_count());
+  Console.println(" unchanged");
+
+  print_histogram("Second jitter", STATS_JITTER);
+  print_histogram("'$' to commit", STATS_SENTENCE);
+  print_histogram("PPS to time", STATS_PPS_LATENCY);
+  print_histogram("Loop", STATS_LOOP);
 }
 
 
 /**
- * Function to print the available serial commands
+ * REC START [file]: record the GPS input to a file (default /capture.bin),
+ * REC STOP: end the recording, REC DUMP [file]: send a recording as
+ * binary, REC: show the state of the recording
  */
-void print_serial_cmds()
+void cmd_rec(uint8_t argc, const char *argv[])
 {
-  Serial.println("Available commands:");
-  Serial.println("\tRAW: Print raw GPS data");
-  Serial.println("\tCLOCK: Print GPS date and time");
-  Serial.println("\tOFFSET: Set the time zone offset (e.g., OFFSET+2)");
-  Serial.println("\tDAYLIGHTON: Enable daylight saving");
-  Serial.println("\tDAYLIGHTOFF: Disable daylight saving");
-}
+  const char *path = argc >= 3 ? argv[2] : RECORDER_DEFAULT_PATH;
 
+  if (argc >= 2 && strcasecmp(argv[1], "START") == 0)
+  {
+    if (!recorder_start(path, hal_micros()))
+    {
+      Console.print("Can't create ");
+      Console.println(path);
+      return;
+    }
+    sched_restart(record_timer, hal_millis(), RECORDER_FLUSH_TIME);
+    Console.print("Recording to ");
+    Console.println(path);
+    return;
+  }
 
-/**
- * Function to load settings from EEPROM
- */
-void load_settings()
-{
-  int address = 0; // Address in EEPROM
-  // Read the settings from EEPROM
-  EEPROM.get(address, settings); 
-  // Check if the settings are valid (e.g., using a magic number or checksum)
-  if (settings.time_zone_offset < -12 || settings.time_zone_offset > 14)
+  if (argc >= 2 && strcasecmp(argv[1], "STOP") == 0)
   {
-    // If settings are invalid, use default values
-    Serial.println("Invalid settings. Loading defaults.");
-    settings = default_settings;
-    save_settings(); // Save the default settings to EEPROM
+    recorder_stop();
+  }
+  else if (argc >= 2 && strcasecmp(argv[1], "DUMP") == 0)
+  {
+    if (recorder_active())
+    {
+      Console.println("Stop the recording first");
+    }
+    else if (recorder_dump(path, hal_console_write) < 0)
+    {
+      Console.print("Can't open ");
+      Console.println(path);
+    }
+    return;
   }
+
+  Console.print(recorder_active() ? "Recording " : "Not recording, last file ");
+  Console.print(recorder_path());
+  Console.print(": ");
+  Console.print(recorder_file_size());
+  Console.print(" bytes, ");
+  Console.print(recorder_records());
+  Console.print(" records, ");
+  Console.print(recorder_dropped());
+  Console.println(" dropped");
 }
 
+
 /**
- * Function to save settings to EEPROM
+ * Print a histogram on one line: count, mean, max and <limit:count bins
  */
-void save_settings()
+void print_histogram(const char *name, uint8_t histogram)
 {
-  // Write the settings to EEPROM
-  EEPROM.put(0, settings); // Write to address 0
-  EEPROM.commit(); // Commit changes to Flash
+  const StatsHistogram &h = stats_histogram(histogram);
+
+  Console.print(name);
+  Console.print(": n ");
+  Console.print(h.count);
+  Console.print(", mean ");
+  Console.print(h.count > 0 ? (uint32_t)(h.sum_us / h.count) : 0);
+  Console.print(" us, max ");
+  Console.print(h.max_us);
+  Console.print(" us |");
+  for (uint8_t i = 0; i < STATS_BINS - 1; i++)
+  {
+    Console.print(" <");
+    Console.print(stats_bin_limit(i));
+    Console.print(":");
+    Console.print(h.bins[i]);
+  }
+  Console.print(" more:");
+  Console.println(h.bins[STATS_BINS - 1]);
 }
 
+
 /**
- * Print the loaded settings
+ * HELP: print the available commands
  */
-void print_settings()
+void cmd_help(uint8_t argc, const char *argv[])
 {
-  Serial.println("Loaded Settings:");
-  Serial.print("Time Zone Offset: ");
-  Serial.println(settings.time_zone_offset);
-  Serial.print("Daylight Saving: ");
-  Serial.println(settings.is_summer_time ? "Enabled" : "Disabled");
+  (void)argc;
+  (void)argv;
+  print_serial_cmds();
 }
 
 
-/*******************************************************************
- * Get user input from the Serial port
- * @return the user command
- *******************************************************************/
-int get_user_serial_input()
+/**
+ * Function to load settings from flash
+ */
+void load_settings()
 {
-  String cmd_in = Serial.readStringUntil('\n');
-
-  cmd_in.trim(); // Remove any extra whitespace
+  uint8_t version = settings_store_load(&settings, sizeof(settings));
 
-  if (cmd_in.equalsIgnoreCase("RAW"))
+  if (version == SETTINGS_VERSION)
   {
-    return RAW;
+    apply_time_zone();
+    return;
   }
-  else if (cmd_in.equalsIgnoreCase("CLOCK"))
-  {
-    return CLOCK;
-  }
-  else if(cmd_in.startsWith("OFFSET")) // Example: OFFSET-2
+
+  // Settings written with EEPROM.put() by older firmware, the bool as a byte
+  struct {
+    int32_t time_zone_offset;
+    uint8_t is_summer_time;
+  } legacy;
+
+  if (version == 1)
   {
-    // Extract the offset value (e.g., "+2" or "-3")
-    String offset_str = cmd_in.substring(6); // Remove "OFFSET"
-    int offset = offset_str.toInt();         // Convert to integer
-    settings.time_zone_offset = offset;      // Update the time zone offset
-    save_settings();                         // Save the settings to EEPROM
-    return OFFSET;
+    // Without a TZ rule, the fixed offset is used as before
+      Console.println("Converting old settings.");
   }
-  else if(cmd_in.startsWith("DAYLIGHT"))
+
+  else if (settings_store_read_legacy(&legacy, sizeof(legacy))
+      && legacy.time_zone_offset >= -12 && legacy.time_zone_offset <= 14
+      && legacy.is_summer_time <= 1)
   {
-    // Extract the daylight saving value (e.g., "ON" or "OFF")
-    String daylight_str = cmd_in.substring(8); // Remove "DAYLIGHT"
-    bool daylight = daylight_str.equalsIgnoreCase("ON");
-    settings.is_summer_time = daylight;    // Update the daylight saving setting
-    save_settings();                           // Save the settings to EEPROM
-    return DAYLIGHT;
+    Console.println("Converting old settings.");
+    memset(&settings, 0, sizeof(settings));
+    settings.time_zone_offset = legacy.time_zone_offset;
+    settings.is_summer_time = legacy.is_summer_time;
   }
   else
   {
-    Serial.print("Unknown command: ");
-    Serial.println(cmd_in);
-    print_serial_cmds();
+    // No valid settings, use default values
+    Console.println("Invalid settings. Loading defaults.");
+    settings = default_settings;
   }
 
-  return -1;
+  apply_time_zone();
+  save_settings();
+}
+
+/**
+ * Function to save settings to flash; unchanged settings aren't written
+ */
+void save_settings()
+{
+  settings_store_save(&settings, sizeof(settings), SETTINGS_VERSION);
+}
+
+/**
+ * Print the loaded settings
+ */
+void print_settings()
+{
+  Console.println("Loaded Settings:");
+  if (settings.time_zone[0] != '\0')
+  {
+    Console.print("Time Zone: ");
+    Console.println(settings.time_zone);
+    return;
+  }
+  Console.print("Time Zone Offset: ");
+  Console.println(settings.time_zone_offset);
+  Console.print("Daylight Saving: ");
+  Console.println(settings.is_summer_time ? "Enabled" : "Disabled");
 }
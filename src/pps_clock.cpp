@@ -0,0 +1,185 @@
+/**
+ *
+ * PPS disciplined time
+ * Tauno Erik
+ *
+ */
+#include "pps_clock.h"
+#include "hal.h"
+#include "console.h"
+
+// Accepted deviation of the measured CPU clock from nominal
+// (ESP8266 crystal is +-10 ppm, leave room for temperature and jitter)
+static const uint32_t PPS_MAX_PPM = 1000;
+
+// Pulses are considered lost after this many milliseconds
+static const uint32_t PPS_TIMEOUT_MS = 1200;
+
+// Written by the interrupt
+static volatile uint32_t edge_cycles = 0;      // cycle counter at the last pulse
+static volatile uint32_t edge_count = 0;       // number of pulses seen
+static volatile uint32_t cycles_per_second = 0; // measured between consecutive pulses
+static volatile uint32_t gap_count = 0;        // first pulse after missing ones
+
+// Pulse paired with a GPS time
+static uint32_t sync_count = 0;
+static int64_t sync_seconds = 0;
+static bool synced = false;
+
+static uint32_t nominal_cycles_per_second = 80000000UL;
+
+// Valid pulse periods, set before the interrupt is attached: the
+// division helper of libgcc may be in flash, which the ISR can't call
+static uint32_t min_period = 0;
+static uint32_t max_period = 0;
+
+
+/**
+ * PPS interrupt: timestamp the pulse
+ */
+void IRAM_ATTR pps_isr()
+{
+  uint32_t now = hal_cycle_count();
+  uint32_t period = now - edge_cycles;
+
+  // Only a pulse exactly one second after the previous one is a valid period
+  if (period > min_period && period < max_period)
+  {
+    cycles_per_second = period;
+  }
+  else
+  {
+    // Pulses were lost, the count no longer tells the seconds
+    gap_count = edge_count + 1;
+  }
+
+  edge_cycles = now;
+  edge_count = edge_count + 1;
+}
+
+
+/**
+ * Read the interrupt state consistently
+ */
+static void pps_read(uint32_t &cycles, uint32_t &count, uint32_t &cps)
+{
+  hal_disable_interrupts();
+  cycles = edge_cycles;
+  count = edge_count;
+  cps = cycles_per_second;
+  hal_enable_interrupts();
+}
+
+
+/**
+ * Start capturing PPS pulses
+ * @param pin: GPIO connected to the GPS module PPS output
+ */
+void pps_begin(uint8_t pin)
+{
+  nominal_cycles_per_second = hal_cpu_mhz() * 1000000UL;
+  uint32_t tolerance = nominal_cycles_per_second / 1000000UL * PPS_MAX_PPM;
+  min_period = nominal_cycles_per_second - tolerance;
+  max_period = nominal_cycles_per_second + tolerance;
+
+  hal_pps_begin(pin, pps_isr);
+}
+
+
+/**
+ * Pair the last pulse with a newly received GPS time.
+ * The GPS module sends the time of a second after the pulse that started it.
+ * @param seconds: GPS time (seconds since 2000)
+ * @param centisecond: fraction of the GPS time, must be 0 for a PPS aligned sentence
+ */
+void pps_set_time(int64_t seconds, uint8_t centisecond)
+{
+  uint32_t cycles, count, cps;
+  pps_read(cycles, count, cps);
+
+  if (centisecond != 0 || cps == 0 || count == 0)
+  {
+    return;
+  }
+
+  // The sentence must belong to the last pulse, i.e. arrive within a second of it
+  if (hal_cycle_count() - cycles >= cps)
+  {
+    return;
+  }
+
+  if (synced && sync_seconds + (count - sync_count) != seconds)
+  {
+    Console.println("PPS: time re-synced");
+  }
+
+  sync_count = count;
+  sync_seconds = seconds;
+  synced = true;
+}
+
+
+/**
+ * Current UTC time interpolated from the last pulse
+ * @param now: UTC time
+ * @return true if PPS is locked; otherwise, false
+ */
+bool pps_now(Epoch &now)
+{
+  uint32_t cycles, count, cps;
+  pps_read(cycles, count, cps);
+
+  if (!synced || cps == 0)
+  {
+    return false;
+  }
+
+  if ((int32_t)(gap_count - sync_count) > 0)
+  {
+    // Paired before an outage; wait for a new GPS time
+    synced = false;
+    return false;
+  }
+
+  uint32_t elapsed = hal_cycle_count() - cycles;
+
+  if (elapsed >= cps / 1000 * PPS_TIMEOUT_MS)
+  {
+    // No pulses, let the caller fall back to the GPS time
+    synced = false;
+    return false;
+  }
+
+  if (elapsed >= cps)
+  {
+    // Late pulse, hold the end of the second
+    elapsed = cps - 1;
+  }
+
+  now.seconds = sync_seconds + (count - sync_count);
+  now.micros = (uint32_t)((uint64_t)elapsed * 1000000UL / cps);
+
+  return true;
+}
+
+
+/**
+ * Number of PPS pulses seen since start
+ */
+uint32_t pps_pulse_count()
+{
+  return edge_count;
+}
+
+
+/**
+ * Time since the last pulse, e.g. to timestamp it with micros()
+ * @return microseconds, valid for up to 53 s at 80 MHz
+ */
+uint32_t pps_edge_age_us()
+{
+  uint32_t cycles, count, cps;
+  pps_read(cycles, count, cps);
+
+  return (hal_cycle_count() - cycles) / (nominal_cycles_per_second / 1000000UL);
+}
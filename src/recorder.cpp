@@ -0,0 +1,295 @@
+/**
+ *
+ * GPS input recorder
+ * Tauno Erik
+ *
+ */
+#include <string.h>
+#include "recorder.h"
+#include "capture.h"
+
+#if defined(ESP8266)
+#include <LittleFS.h>
+
+static File file;
+static bool mounted = false;
+
+static bool file_open(const char *path)
+{
+  if (!mounted)
+  {
+    mounted = LittleFS.begin();
+  }
+  if (!mounted)
+  {
+    return false;
+  }
+  file = LittleFS.open(path, "w");
+  return file;
+}
+
+static size_t file_write(const uint8_t *data, size_t len)
+{
+  return file.write(data, len);
+}
+
+static void file_close()
+{
+  file.close();
+}
+
+static int32_t file_copy(const char *path, recorder_write write)
+{
+  if (!mounted)
+  {
+    mounted = LittleFS.begin();
+  }
+  File in = mounted ? LittleFS.open(path, "r") : File();
+  if (!in)
+  {
+    return -1;
+  }
+
+  uint8_t chunk[256];
+  int32_t total = 0;
+  size_t len;
+  while ((len = in.read(chunk, sizeof(chunk))) > 0)
+  {
+    write(chunk, len);
+    total += len;
+    yield();
+  }
+  in.close();
+  return total;
+}
+
+#else
+// Host builds: a file in the working directory
+#include <stdio.h>
+
+static FILE *file = 0;
+
+static bool file_open(const char *path)
+{
+  // Without the leading '/' of the LittleFS path
+  file = fopen(path[0] == '/' ? path + 1 : path, "wb");
+  return file != 0;
+}
+
+static size_t file_write(const uint8_t *data, size_t len)
+{
+  return fwrite(data, 1, len, file);
+}
+
+static void file_close()
+{
+  fclose(file);
+  file = 0;
+}
+
+static int32_t file_copy(const char *path, recorder_write write)
+{
+  FILE *in = fopen(path[0] == '/' ? path + 1 : path, "rb");
+  if (in == 0)
+  {
+    return -1;
+  }
+
+  uint8_t chunk[256];
+  int32_t total = 0;
+  size_t len;
+  while ((len = fread(chunk, 1, sizeof(chunk), in)) > 0)
+  {
+    write(chunk, len);
+    total += len;
+  }
+  fclose(in);
+  return total;
+}
+#endif
+
+static uint8_t buffer[RECORDER_BUFFER_SIZE];
+static size_t buffered = 0;
+
+static bool active = false;
+static char file_path[32] = "";
+static uint32_t prev_time_us = 0; // time of the last record in the buffer
+
+// Counters
+static uint32_t file_size = 0;
+static uint32_t records = 0;
+static uint32_t dropped = 0;
+
+
+/**
+ * Append one record to the buffer, or drop it if there is no room
+ */
+static void add_record(uint32_t time_us, uint8_t kind, const uint8_t *data, uint16_t len)
+{
+  if (!active)
+  {
+    return;
+  }
+
+  if (buffered + len + CAPTURE_MAX_OVERHEAD > sizeof(buffer))
+  {
+    // The next record's delta counts from the last one kept
+    dropped++;
+    return;
+  }
+
+  buffered += capture_record(buffer + buffered, time_us - prev_time_us, kind, data, len);
+  prev_time_us = time_us;
+  records++;
+}
+
+
+/**
+ * Start recording to a new file; a running recording is stopped first
+ * @param path: LittleFS path, e.g. "/capture.bin"
+ * @param now_us: micros() at the start
+ * @return false if the file can't be created
+ */
+bool recorder_start(const char *path, uint32_t now_us)
+{
+  recorder_stop();
+
+  if (strlen(path) >= sizeof(file_path) || !file_open(path))
+  {
+    return false;
+  }
+
+  strcpy(file_path, path);
+  file_size = 0;
+  records = 0;
+  dropped = 0;
+  buffered = capture_header(buffer);
+  prev_time_us = now_us;
+  active = true;
+  return true;
+}
+
+
+/**
+ * Write what is buffered and close the file
+ */
+void recorder_stop()
+{
+  if (!active)
+  {
+    return;
+  }
+
+  recorder_flush();
+  if (active)
+  {
+    active = false;
+    file_close();
+  }
+}
+
+
+bool recorder_active()
+{
+  return active;
+}
+
+
+/**
+ * Record bytes from the GPS module
+ * @param time_us: micros() at their arrival
+ */
+void recorder_data(uint32_t time_us, const uint8_t *data, size_t len)
+{
+  while (len > 0)
+  {
+    uint16_t chunk = len < CAPTURE_MAX_DATA ? len : CAPTURE_MAX_DATA;
+    add_record(time_us, CAPTURE_DATA, data, chunk);
+    data += chunk;
+    len -= chunk;
+  }
+}
+
+
+/**
+ * Record a PPS pulse
+ * @param time_us: micros() at the pulse
+ */
+void recorder_pps(uint32_t time_us)
+{
+  add_record(time_us, CAPTURE_PPS, 0, 0);
+}
+
+
+/**
+ * Move the buffered records to the file. Call from the main loop.
+ * @return false if the recording stopped because the file is full
+ */
+bool recorder_flush()
+{
+  if (!active)
+  {
+    return false;
+  }
+
+  if (buffered > 0)
+  {
+    size_t written = file_write(buffer, buffered);
+    file_size += written;
+    bool full = written != buffered || file_size >= RECORDER_MAX_FILE_SIZE;
+    buffered = 0;
+
+    if (full)
+    {
+      active = false;
+      file_close();
+      return false;
+    }
+  }
+  return true;
+}
+
+
+/**
+ * @return path of the last recording
+ */
+const char *recorder_path()
+{
+  return file_path;
+}
+
+
+/**
+ * @return bytes written to the file, without the buffered ones
+ */
+uint32_t recorder_file_size()
+{
+  return file_size;
+}
+
+
+uint32_t recorder_records()
+{
+  return records;
+}
+
+
+/**
+ * @return records lost because the buffer was full
+ */
+uint32_t recorder_dropped()
+{
+  return dropped;
+}
+
+
+/**
+ * Send a capture file, e.g. to the serial port
+ * @param path: LittleFS path
+ * @param write: called with each chunk of the file
+ * @return number of bytes sent, -1 if the file can't be opened
+ */
+int32_t recorder_dump(const char *path, recorder_write write)
+{
+  return file_copy(path, write);
+}
@@ -0,0 +1,197 @@
+/**
+ *
+ * Cooperative scheduler
+ * Tauno Erik
+ *
+ */
+#include "scheduler.h"
+
+struct Timer {
+  uint32_t due;
+  uint32_t period; // 0 for a one-shot timer
+  sched_callback callback;
+  bool active;
+};
+
+static Timer timers[SCHED_MAX_TIMERS];
+static uint8_t timer_count = 0;
+
+static sched_callback handlers[SCHED_MAX_EVENTS];
+
+// Posted events. One byte per event so an interrupt can post without locking.
+static volatile bool pending[SCHED_MAX_EVENTS];
+
+
+/**
+ * Set the handler of an event
+ * @param event: event number, 0 to SCHED_MAX_EVENTS - 1
+ * @param callback: function to call when the event is posted
+ */
+void sched_on(uint8_t event, sched_callback callback)
+{
+  if (event < SCHED_MAX_EVENTS)
+  {
+    handlers[event] = callback;
+  }
+}
+
+
+/**
+ * Post an event; posting it again before it is handled has no effect.
+ * Safe to call from an interrupt.
+ */
+void sched_post(uint8_t event)
+{
+  if (event < SCHED_MAX_EVENTS)
+  {
+    pending[event] = true;
+  }
+}
+
+
+/**
+ * @return true if events are waiting to be handled
+ */
+bool sched_pending()
+{
+  for (uint8_t event = 0; event < SCHED_MAX_EVENTS; event++)
+  {
+    if (pending[event])
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+
+/**
+ * Add a timer
+ * @param now_ms: current time
+ * @param delay_ms: time to the first call
+ * @param period_ms: time between calls, 0 for a single call
+ * @return timer number or -1 if there is no room
+ */
+static int8_t add_timer(uint32_t now_ms, uint32_t delay_ms, uint32_t period_ms, sched_callback callback)
+{
+  if (timer_count >= SCHED_MAX_TIMERS)
+  {
+    return -1;
+  }
+
+  Timer &t = timers[timer_count];
+  t.due = now_ms + delay_ms;
+  t.period = period_ms;
+  t.callback = callback;
+  t.active = true;
+
+  return timer_count++;
+}
+
+
+/**
+ * Add a periodic timer
+ */
+int8_t sched_timer(uint32_t now_ms, uint32_t period_ms, sched_callback callback)
+{
+  return add_timer(now_ms, period_ms, period_ms, callback);
+}
+
+
+/**
+ * Add a one-shot timer, re-arm it with sched_restart()
+ */
+int8_t sched_timeout(uint32_t now_ms, uint32_t delay_ms, sched_callback callback)
+{
+  return add_timer(now_ms, delay_ms, 0, callback);
+}
+
+
+/**
+ * (Re)start a timer
+ * @param delay_ms: time to the next call
+ */
+void sched_restart(int8_t timer, uint32_t now_ms, uint32_t delay_ms)
+{
+  if (timer >= 0 && timer < timer_count)
+  {
+    timers[timer].due = now_ms + delay_ms;
+    timers[timer].active = true;
+  }
+}
+
+
+/**
+ * Handle posted events and due timers
+ * @param now_ms: current time
+ * @return milliseconds until the next timer is due, 0 if there is more to do
+ */
+uint32_t sched_dispatch(uint32_t now_ms)
+{
+  // Events first, in order of their number
+  for (uint8_t event = 0; event < SCHED_MAX_EVENTS; event++)
+  {
+    if (pending[event])
+    {
+      // Clear before handling, so a post during the handler is not lost
+      pending[event] = false;
+      if (handlers[event])
+      {
+        handlers[event]();
+      }
+    }
+  }
+
+  for (uint8_t i = 0; i < timer_count; i++)
+  {
+    Timer &t = timers[i];
+
+    if (t.active && (int32_t)(now_ms - t.due) >= 0)
+    {
+      if (t.period)
+      {
+        // Keep the phase, skip periods that were missed
+        do
+        {
+          t.due += t.period;
+        } while ((int32_t)(now_ms - t.due) >= 0);
+      }
+      else
+      {
+        t.active = false;
+      }
+
+      t.callback();
+    }
+  }
+
+  if (sched_pending())
+  {
+    return 0;
+  }
+
+  // Callbacks may have restarted timers, look for the next one afterwards
+  uint32_t idle = UINT32_MAX;
+
+  for (uint8_t i = 0; i < timer_count; i++)
+  {
+    const Timer &t = timers[i];
+
+    if (!t.active)
+    {
+      continue;
+    }
+
+    if ((int32_t)(now_ms - t.due) >= 0)
+    {
+      return 0;
+    }
+
+    if (t.due - now_ms < idle)
+    {
+      idle = t.due - now_ms;
+    }
+  }
+
+  return idle;
+}
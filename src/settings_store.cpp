@@ -0,0 +1,250 @@
+/**
+ *
+ * Wear-levelled settings store
+ * Tauno Erik
+ *
+ */
+#include <string.h>
+#include "settings_store.h"
+#include "hal.h"
+
+#define RECORD_MAGIC 0x5E77
+#define ERASED_MAGIC 0xFFFF
+
+// Flash is read and written in 32-bit words
+#define ALIGN4(n) (((n) + 3) & ~3)
+
+struct RecordHeader {
+  uint16_t magic;
+  uint8_t version;  // layout of the settings struct
+  uint8_t size;     // settings bytes
+  uint32_t sequence;
+};
+
+// Header, settings padded to 32 bits, CRC
+#define RECORD_SIZE(size) (sizeof(RecordHeader) + ALIGN4(size) + 4)
+#define MAX_RECORD_SIZE RECORD_SIZE(SETTINGS_STORE_MAX_SIZE)
+
+// Where the next record goes, HAL_STORE_SIZE if the log hasn't been scanned
+static uint16_t write_offset = HAL_STORE_SIZE;
+static uint32_t sequence = 0;
+
+// CRC of the newest record, to skip writing unchanged settings
+static uint32_t last_crc = 0;
+static bool have_record = false;
+
+
+/**
+ * CRC-32 (IEEE), bit by bit: the records are short and rarely read
+ */
+static uint32_t crc32(const uint8_t *data, uint16_t len, uint32_t crc = 0xFFFFFFFF)
+{
+  while (len--)
+  {
+    crc ^= *data++;
+    for (uint8_t bit = 0; bit < 8; bit++)
+    {
+      crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+    }
+  }
+  return crc;
+}
+
+
+/**
+ * Find the newest valid record and the end of the log
+ * @param data: where to copy the newest settings, or 0
+ * @param size: size of data
+ * @return version of the newest record, 0 if there is none
+ */
+static uint8_t scan(void *data, uint8_t size)
+{
+  uint32_t record[MAX_RECORD_SIZE / 4];
+  RecordHeader *header = (RecordHeader *)record;
+  uint8_t version = 0;
+  uint16_t offset = 0;
+
+  have_record = false;
+  sequence = 0;
+
+  while (offset + sizeof(RecordHeader) <= HAL_STORE_SIZE)
+  {
+    if (!hal_store_read(offset, record, sizeof(RecordHeader)))
+    {
+      break;
+    }
+
+    // End of the log, or the unreadable remains of an interrupted write
+    if (header->magic != RECORD_MAGIC || header->size > SETTINGS_STORE_MAX_SIZE)
+    {
+      break;
+    }
+
+    uint16_t record_size = RECORD_SIZE(header->size);
+    if (offset + record_size > HAL_STORE_SIZE)
+    {
+      break;
+    }
+
+    hal_store_read(offset, record, record_size);
+    uint32_t crc = record[record_size / 4 - 1];
+    if (crc == crc32((const uint8_t *)record, record_size - 4) && header->sequence >= sequence)
+    {
+      have_record = true;
+      sequence = header->sequence;
+      last_crc = crc;
+      version = header->version;
+      if (data != 0)
+      {
+        memset(data, 0, size);
+        memcpy(data, record + sizeof(RecordHeader) / 4, header->size < size ? header->size : size);
+      }
+    }
+
+    offset += record_size;
+  }
+
+  write_offset = offset;
+  return version;
+}
+
+
+/**
+ * @return true if the area is erased and can be written
+ */
+static bool is_erased(uint16_t offset, uint16_t len)
+{
+  uint32_t word;
+
+  for (uint16_t i = 0; i < len; i += 4)
+  {
+    if (!hal_store_read(offset + i, &word, 4) || word != 0xFFFFFFFF)
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+
+/**
+ * Load the newest settings
+ * @param data: settings struct to fill; bytes the record doesn't
+ *              have are set to 0
+ * @param size: size of the settings struct
+ * @return layout version of the record, 0 if there are no settings
+ */
+uint8_t settings_store_load(void *data, uint8_t size)
+{
+  return scan(data, size);
+}
+
+
+/**
+ * Append the settings to the log, if they have changed
+ * @param data: settings struct
+ * @param size: size of the settings struct, up to SETTINGS_STORE_MAX_SIZE
+ * @param version: layout version of the settings struct, 1 to 255
+ * @return true if the settings were written
+ */
+bool settings_store_save(const void *data, uint8_t size, uint8_t version)
+{
+  if (size > SETTINGS_STORE_MAX_SIZE || version == 0)
+  {
+    return false;
+  }
+
+  if (write_offset == HAL_STORE_SIZE)
+  {
+    scan(0, 0);
+  }
+
+  uint32_t record[MAX_RECORD_SIZE / 4];
+  uint16_t record_size = RECORD_SIZE(size);
+  RecordHeader *header = (RecordHeader *)record;
+
+  memset(record, 0, sizeof(record));
+  header->magic = RECORD_MAGIC;
+  header->version = version;
+  header->size = size;
+  header->sequence = sequence;
+  memcpy(record + sizeof(RecordHeader) / 4, data, size);
+
+  // Unchanged settings would make the same record as the newest one
+  if (have_record && crc32((const uint8_t *)record, record_size - 4) == last_crc)
+  {
+    return false;
+  }
+
+  header->sequence = sequence + 1;
+  uint32_t crc = crc32((const uint8_t *)record, record_size - 4);
+  record[record_size / 4 - 1] = crc;
+
+  // Sector full, or something else (e.g. the old EEPROM data) is in the way
+  if (write_offset + record_size > HAL_STORE_SIZE || !is_erased(write_offset, record_size))
+  {
+    if (!hal_store_erase())
+    {
+      return false;
+    }
+    write_offset = 0;
+  }
+
+  if (!hal_store_write(write_offset, record, record_size))
+  {
+    // Don't write over a half-written record, start a new sector next time
+    write_offset = HAL_STORE_SIZE;
+    return false;
+  }
+
+  write_offset += record_size;
+  sequence++;
+  last_crc = crc;
+  have_record = true;
+  return true;
+}
+
+
+/**
+ * Read the settings the way EEPROM.put() left them at the start of the
+ * sector, before there was a log
+ * @param data: settings struct to fill
+ * @param size: size of the settings struct
+ * @return false if the sector holds a log instead
+ */
+bool settings_store_read_legacy(void *data, uint8_t size)
+{
+  uint32_t words[MAX_RECORD_SIZE / 4];
+
+  if (size > sizeof(words) || !hal_store_read(0, words, ALIGN4(size)))
+  {
+    return false;
+  }
+
+  if (((RecordHeader *)words)->magic == RECORD_MAGIC)
+  {
+    return false;
+  }
+
+  memcpy(data, words, size);
+  return true;
+}
+
+
+/**
+ * @return sequence number of the newest record, i.e. how many times
+ *         the settings have been saved
+ */
+uint32_t settings_store_sequence()
+{
+  return sequence;
+}
+
+
+/**
+ * @return bytes of the sector in use
+ */
+uint16_t settings_store_used()
+{
+  return write_offset == HAL_STORE_SIZE ? 0 : write_offset;
+}
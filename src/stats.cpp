@@ -0,0 +1,169 @@
+/**
+ *
+ * Timing statistics
+ * Tauno Erik
+ *
+ */
+#include <string.h>
+#include "stats.h"
+
+static const uint32_t US_PER_SECOND = 1000000UL;
+
+// Upper limits of the bins in microseconds, about half a decade apart;
+// the last bin has everything above
+static const uint32_t bin_limits[STATS_BINS] = {
+  100, 300, 1000, 3000, 10000, 30000, 100000, UINT32_MAX
+};
+
+static StatsHistogram histograms[STATS_HISTOGRAM_COUNT];
+
+// GPS seconds
+static bool have_second = false;
+static uint32_t prev_second_us = 0;
+
+// Data rate, measured over at least a second
+static bool have_bytes = false;
+static uint32_t rate_start_ms = 0;
+static uint32_t rate_start_received = 0;
+static uint32_t bytes_per_second = 0;
+static uint32_t max_bytes_per_second = 0;
+
+
+/**
+ * Clear all statistics
+ */
+void stats_reset()
+{
+  memset(histograms, 0, sizeof(histograms));
+  have_second = false;
+  have_bytes = false;
+  bytes_per_second = 0;
+  max_bytes_per_second = 0;
+}
+
+
+/**
+ * Add a time to a histogram
+ * @param histogram: STATS_JITTER ... STATS_LOOP
+ * @param us: the time in microseconds
+ */
+void stats_add(uint8_t histogram, uint32_t us)
+{
+  if (histogram >= STATS_HISTOGRAM_COUNT)
+  {
+    return;
+  }
+
+  StatsHistogram &h = histograms[histogram];
+  uint8_t bin = 0;
+  while (us >= bin_limits[bin] && bin < STATS_BINS - 1)
+  {
+    bin++;
+  }
+
+  if (h.bins[bin] < UINT16_MAX)
+  {
+    h.bins[bin]++;
+  }
+  h.count++;
+  h.sum_us += us;
+  if (us > h.max_us)
+  {
+    h.max_us = us;
+  }
+}
+
+
+/**
+ * A new GPS second was received; its distance from a whole number of
+ * seconds after the previous one goes to the jitter histogram
+ * @param now_us: local time of the reception
+ */
+void stats_second(uint32_t now_us)
+{
+  if (have_second)
+  {
+    uint32_t fraction = (now_us - prev_second_us) % US_PER_SECOND;
+    stats_add(STATS_JITTER, fraction < US_PER_SECOND / 2 ? fraction : US_PER_SECOND - fraction);
+  }
+
+  prev_second_us = now_us;
+  have_second = true;
+}
+
+
+/**
+ * Update the data rate
+ * @param received: total bytes received so far
+ * @param now_ms: time now
+ */
+void stats_bytes(uint32_t received, uint32_t now_ms)
+{
+  if (!have_bytes)
+  {
+    rate_start_ms = now_ms;
+    rate_start_received = received;
+    have_bytes = true;
+    return;
+  }
+
+  uint32_t elapsed_ms = now_ms - rate_start_ms;
+  if (elapsed_ms < 1000)
+  {
+    return;
+  }
+
+  bytes_per_second = (uint64_t)(received - rate_start_received) * 1000 / elapsed_ms;
+  if (bytes_per_second > max_bytes_per_second)
+  {
+    max_bytes_per_second = bytes_per_second;
+  }
+
+  rate_start_ms = now_ms;
+  rate_start_received = received;
+}
+
+
+const StatsHistogram &stats_histogram(uint8_t histogram)
+{
+  return histograms[histogram < STATS_HISTOGRAM_COUNT ? histogram : 0];
+}
+
+
+/**
+ * @return upper limit of a bin in microseconds, UINT32_MAX for the last
+ */
+uint32_t stats_bin_limit(uint8_t bin)
+{
+  return bin_limits[bin < STATS_BINS ? bin : STATS_BINS - 1];
+}
+
+
+uint32_t stats_bytes_per_second()
+{
+  return bytes_per_second;
+}
+
+
+uint32_t stats_max_bytes_per_second()
+{
+  return max_bytes_per_second;
+}
+
+
+/**
+ * Fill the header and the fields of this module; the caller fills the
+ * counters of the other modules
+ */
+void stats_fill_dump(StatsDump &dump)
+{
+  memset(&dump, 0, sizeof(dump));
+  dump.magic = STATS_DUMP_MAGIC;
+  dump.version = STATS_DUMP_VERSION;
+  dump.bins = STATS_BINS;
+  dump.size = sizeof(StatsDump);
+  dump.sentence_types = STATS_SENTENCE_TYPES;
+  dump.bytes_per_second = bytes_per_second;
+  dump.max_bytes_per_second = max_bytes_per_second;
+  memcpy(dump.histograms, histograms, sizeof(histograms));
+}
@@ -0,0 +1,431 @@
+/**
+ *
+ * Time zones with daylight saving time rules
+ * Tauno Erik
+ *
+ */
+#include "time_zone.h"
+
+#include <ctype.h>
+#include <stdio.h>
+#include <string.h>
+
+static const int32_t SECONDS_PER_DAY = 86400;
+
+// Transitions may be up to a week away from midnight (RFC 8536)
+static const int32_t MAX_TRANSITION_HOURS = 167;
+static const int32_t MAX_OFFSET_HOURS = 24;
+
+// Used when a DST name is given without rules, as glibc does
+static const char DEFAULT_RULES[] = ",M3.2.0,M11.1.0";
+
+
+/**
+ * Parse a zone name: letters, or anything in <> such as <+03>
+ * @return the rest of the string, 0 if there is no valid name
+ */
+static const char *parse_name(const char *p, char *name)
+{
+  uint8_t length = 0;
+
+  if (*p == '<')
+  {
+    p++;
+    while (*p != '\0' && *p != '>')
+    {
+      if (length < TZ_NAME_SIZE - 1)
+      {
+        name[length++] = *p;
+      }
+      p++;
+    }
+    if (*p++ != '>')
+    {
+      return 0;
+    }
+  }
+  else
+  {
+    while (isalpha((unsigned char)*p))
+    {
+      if (length < TZ_NAME_SIZE - 1)
+      {
+        name[length++] = *p;
+      }
+      p++;
+    }
+  }
+
+  name[length] = '\0';
+  return length >= 3 ? p : 0;
+}
+
+
+/**
+ * Parse [+-]hh[:mm[:ss]]
+ * @param seconds: the time in seconds
+ * @param max_hours: largest allowed hour
+ * @return the rest of the string, 0 if there is no valid time
+ */
+static const char *parse_time(const char *p, int32_t &seconds, int32_t max_hours)
+{
+  bool negative = false;
+  int32_t parts[3] = {0, 0, 0};
+
+  if (*p == '+' || *p == '-')
+  {
+    negative = *p++ == '-';
+  }
+
+  for (uint8_t i = 0; i < 3; i++)
+  {
+    if (!isdigit((unsigned char)*p))
+    {
+      return 0;
+    }
+    for (uint8_t digits = 0; isdigit((unsigned char)*p); digits++)
+    {
+      if (digits == 3)
+      {
+        return 0;
+      }
+      parts[i] = parts[i] * 10 + (*p++ - '0');
+    }
+    if (*p != ':' || i == 2)
+    {
+      break;
+    }
+    p++;
+  }
+
+  if (parts[0] > max_hours || parts[1] > 59 || parts[2] > 59)
+  {
+    return 0;
+  }
+
+  seconds = parts[0] * 3600 + parts[1] * 60 + parts[2];
+  if (negative)
+  {
+    seconds = -seconds;
+  }
+  return p;
+}
+
+
+/**
+ * Parse a number in the range min..max
+ * @return the rest of the string, 0 if there is no valid number
+ */
+static const char *parse_number(const char *p, uint16_t &value, uint16_t min, uint16_t max)
+{
+  uint32_t number = 0;
+
+  if (!isdigit((unsigned char)*p))
+  {
+    return 0;
+  }
+  while (isdigit((unsigned char)*p) && number <= max)
+  {
+    number = number * 10 + (*p++ - '0');
+  }
+
+  if (number < min || number > max)
+  {
+    return 0;
+  }
+  value = number;
+  return p;
+}
+
+
+/**
+ * Parse a transition: Mm.w.d, Jn or n, with an optional /time
+ * @return the rest of the string, 0 if there is no valid transition
+ */
+static const char *parse_transition(const char *p, TzTransition &t)
+{
+  uint16_t value;
+
+  memset(&t, 0, sizeof(t));
+
+  if (*p == 'M')
+  {
+    t.type = 'M';
+    if ((p = parse_number(p + 1, value, 1, 12)) == 0 || *p++ != '.')
+    {
+      return 0;
+    }
+    t.month = value;
+    if ((p = parse_number(p, value, 1, 5)) == 0 || *p++ != '.')
+    {
+      return 0;
+    }
+    t.week = value;
+    if ((p = parse_number(p, value, 0, 6)) == 0)
+    {
+      return 0;
+    }
+    t.weekday = value;
+  }
+  else if (*p == 'J')
+  {
+    t.type = 'J';
+    if ((p = parse_number(p + 1, t.day, 1, 365)) == 0)
+    {
+      return 0;
+    }
+  }
+  else
+  {
+    t.type = 'D';
+    if ((p = parse_number(p, t.day, 0, 365)) == 0)
+    {
+      return 0;
+    }
+  }
+
+  t.time = 2 * 3600;
+  if (*p == '/')
+  {
+    p = parse_time(p + 1, t.time, MAX_TRANSITION_HOURS);
+  }
+  return p;
+}
+
+
+static bool is_leap_year(int year)
+{
+  return (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+}
+
+
+/**
+ * Day of a transition in the given year
+ * @return days since 2000-01-01
+ */
+static int32_t transition_day(const TzTransition &t, int year)
+{
+  int32_t day;
+
+  if (t.type == 'J')
+  {
+    // 1..365, February 29 is never counted
+    day = date_to_days(year, 1, 1) + t.day - 1;
+    if (t.day >= 60 && is_leap_year(year))
+    {
+      day++;
+    }
+    return day;
+  }
+
+  if (t.type == 'D')
+  {
+    return date_to_days(year, 1, 1) + t.day;
+  }
+
+  // The first given weekday of the month, then week - 1 weeks later
+  int32_t first = date_to_days(year, t.month, 1);
+  day = first + (t.weekday + 7 - day_of_week(first)) % 7 + (t.week - 1) * 7;
+
+  // Week 5 is the last one, the month may have only four
+  if (t.week == 5)
+  {
+    int32_t next_month = t.month == 12 ? date_to_days(year + 1, 1, 1)
+                                       : date_to_days(year, t.month + 1, 1);
+    if (day >= next_month)
+    {
+      day -= 7;
+    }
+  }
+  return day;
+}
+
+
+/**
+ * UTC instant of a transition; its time is in the local time before it
+ * @return seconds since 2000-01-01 00:00:00 UTC
+ */
+static int64_t transition_epoch(const TzTransition &t, int year, int32_t offset_before)
+{
+  return (int64_t)transition_day(t, year) * SECONDS_PER_DAY + t.time - offset_before;
+}
+
+
+/**
+ * Find the offset at epoch and the interval it holds for
+ */
+static void update_cache(TimeZone &tz, int64_t epoch)
+{
+  tz.valid_from = INT64_MIN;
+  tz.valid_until = INT64_MAX;
+  tz.is_dst = false;
+
+  if (tz.has_dst)
+  {
+    // The transitions around the epoch, in time order. The local year
+    // may differ from the UTC year and the order of the transitions in
+    // a year depends on the hemisphere.
+    DateTime dt;
+    epoch_to_date_time(epoch, dt);
+
+    int64_t at[6];
+    bool to_dst[6];
+    uint8_t count = 0;
+
+    for (int year = dt.year - 1; year <= dt.year + 1; year++)
+    {
+      int64_t start = transition_epoch(tz.start, year, tz.std_offset);
+      int64_t end = transition_epoch(tz.end, year, tz.dst_offset);
+
+      for (uint8_t i = 0; i < 2; i++)
+      {
+        int64_t when = i == 0 ? start : end;
+        uint8_t j = count++;
+        for (; j > 0 && at[j - 1] > when; j--)
+        {
+          at[j] = at[j - 1];
+          to_dst[j] = to_dst[j - 1];
+        }
+        at[j] = when;
+        to_dst[j] = i == 0;
+      }
+    }
+
+    tz.is_dst = !to_dst[0];
+    for (uint8_t i = 0; i < count; i++)
+    {
+      if (at[i] > epoch)
+      {
+        tz.valid_until = at[i];
+        break;
+      }
+      tz.is_dst = to_dst[i];
+      tz.valid_from = at[i];
+    }
+  }
+
+  tz.offset = tz.is_dst ? tz.dst_offset : tz.std_offset;
+}
+
+
+/**
+ * Set a time zone from a POSIX TZ string, e.g. "EET-2EEST,M3.5.0/3,M10.5.0/4"
+ * @param tz: the time zone, unchanged if the string isn't valid
+ * @param rule: the TZ string
+ * @return false if the string isn't valid
+ */
+bool tz_parse(TimeZone &tz, const char *rule)
+{
+  TimeZone zone;
+  int32_t offset;
+
+  memset(&zone, 0, sizeof(zone));
+
+  // Standard time: name and offset west of UTC
+  const char *p = parse_name(rule, zone.std_name);
+  if (p == 0 || (p = parse_time(p, offset, MAX_OFFSET_HOURS)) == 0)
+  {
+    return false;
+  }
+  zone.std_offset = -offset;
+
+  // Daylight saving time: name, offset, start and end
+  if (*p != '\0')
+  {
+    if ((p = parse_name(p, zone.dst_name)) == 0)
+    {
+      return false;
+    }
+
+    zone.dst_offset = zone.std_offset + 3600;
+    if (*p != ',' && *p != '\0')
+    {
+      if ((p = parse_time(p, offset, MAX_OFFSET_HOURS)) == 0)
+      {
+        return false;
+      }
+      zone.dst_offset = -offset;
+    }
+
+    if (*p == '\0')
+    {
+      p = DEFAULT_RULES;
+    }
+    if (*p++ != ','
+        || (p = parse_transition(p, zone.start)) == 0
+        || *p++ != ','
+        || (p = parse_transition(p, zone.end)) == 0
+        || *p != '\0')
+    {
+      return false;
+    }
+
+    zone.has_dst = true;
+  }
+
+  tz = zone;
+  return true;
+}
+
+
+/**
+ * Set a time zone with a fixed offset and no daylight saving time
+ * @param tz: the time zone
+ * @param offset: seconds east of UTC
+ */
+void tz_fixed(TimeZone &tz, int32_t offset)
+{
+  memset(&tz, 0, sizeof(tz));
+  tz.std_offset = offset;
+
+  // Named like <+0530> in the tz database
+  int32_t minutes = (offset < 0 ? -offset : offset) / 60;
+  int hours = minutes / 60 % 100; // no offset has more than two digits
+  char sign = offset < 0 ? '-' : '+';
+  if (minutes % 60 == 0)
+  {
+    snprintf(tz.std_name, TZ_NAME_SIZE, "%c%02d", sign, hours);
+  }
+  else
+  {
+    snprintf(tz.std_name, TZ_NAME_SIZE, "%c%02d%02d", sign, hours, (int)(minutes % 60));
+  }
+}
+
+
+/**
+ * Offset from UTC to local time
+ * @param tz: the time zone
+ * @param seconds: UTC, seconds since 2000-01-01 00:00:00
+ * @return seconds to add to UTC
+ */
+int32_t tz_offset(TimeZone &tz, int64_t seconds)
+{
+  // seconds in [valid_from, valid_until), with one comparison
+  if ((uint64_t)seconds - (uint64_t)tz.valid_from >= (uint64_t)tz.valid_until - (uint64_t)tz.valid_from)
+  {
+    update_cache(tz, seconds);
+  }
+  return tz.offset;
+}
+
+
+/**
+ * Convert UTC to local date and time
+ * @param tz: the time zone
+ * @param seconds: UTC, seconds since 2000-01-01 00:00:00
+ * @param dt: the local date and time
+ */
+void tz_local(TimeZone &tz, int64_t seconds, DateTime &dt)
+{
+  epoch_to_date_time(seconds + tz_offset(tz, seconds), dt);
+}
+
+
+/**
+ * @return abbreviation of the time in effect at the last conversion, e.g. "EEST"
+ */
+const char *tz_name(const TimeZone &tz)
+{
+  return tz.is_dst ? tz.dst_name : tz.std_name;
+}
@@ -0,0 +1,1080 @@
+/**
+ *
+ * Fuzzing target for the NMEA and UBX parsers
+ * Started: 16.10.2026
+ * Tauno Erik
+ *
+ * Every input is decoded four ways, and the run aborts when they disagree
+ * (or a sanitizer trips):
+ *   - TinyGPSPlus::encode(char), one byte at a time
+ *   - TinyGPSPlus::encode(buf, len), in chunks of 1..64 bytes like
+ *     gps_uart hands them over; the chunk sizes are derived from the input
+ *   - the same two through TinyGPSUbx, which also takes out UBX frames
+ * and the byte-wise NMEA decoder is checked against a reference parser,
+ * a slow and plain implementation of the rules below that must pass and
+ * fail the same sentences and commit the same date, time and location.
+ *
+ * The sentence rules of TinyGPSPlus::encode():
+ *   - a sentence starts at '$'; bytes outside of a sentence are ignored
+ *   - terms end at ',', '*', CR or LF; the term after the first '*' is the
+ *     checksum, exactly two hex digits of the XOR of the bytes between
+ *     '$' and '*', and ends the sentence
+ *   - the sentence is rejected, and counted with the checksum failures, on
+ *     a byte that isn't printable ASCII, a CR or LF before the checksum,
+ *     a term of a parsed sentence (GGA, RMC, GSV, GSA, VTG, ZDA, GLL) longer
+ *     than _GPS_MAX_FIELD_SIZE - 1, more than 255 terms, or a time, date,
+ *     latitude or longitude out of range
+ *
+ * Build with libFuzzer (clang):
+ *   clang++ -g -O1 -fsanitize=fuzzer,address,undefined \
+ *       -fno-sanitize-recover=all -DFUZZ_LIBFUZZER \
+ *       -Ilib/TinyGPSPlus-master/src tools/fuzz/fuzz_nmea.cpp \
+ *       lib/TinyGPSPlus-master/src/TinyGPS++.cpp \
+ *       lib/TinyGPSPlus-master/src/TinyGPSUbx.cpp -o fuzz_nmea
+ *   mkdir -p corpus && ./fuzz_nmea -dict=tools/fuzz/nmea.dict corpus tools/fuzz/corpus
+ *
+ * Build without a fuzzer, or for AFL++ (with afl-clang-fast++ instead of g++):
+ *   g++ -g -O1 -fsanitize=address,undefined -fno-sanitize-recover=all \
+ *       -Ilib/TinyGPSPlus-master/src tools/fuzz/fuzz_nmea.cpp \
+ *       lib/TinyGPSPlus-master/src/TinyGPS++.cpp \
+ *       lib/TinyGPSPlus-master/src/TinyGPSUbx.cpp -o fuzz_nmea
+ *   afl-fuzz -i tools/fuzz/corpus -o findings -x tools/fuzz/nmea.dict -- ./fuzz_nmea
+ *
+ * Usage without libFuzzer:
+ *   ./fuzz_nmea < input              check one input (AFL)
+ *   ./fuzz_nmea FILE...              check the files, e.g. a corpus
+ *   ./fuzz_nmea -m COUNT FILE...     check COUNT random mutations of the files
+ *   ./fuzz_nmea -t [-r MAX] [FILE...]
+ *                                    throughput of TinyGPSUbx::encode(buf, len)
+ *                                    on random bytes and on the files (build
+ *                                    with -O2 and no sanitizers); fails if any
+ *                                    is more than MAX (default 3) times slower
+ *                                    per byte than clean NMEA
+ *
+ */
+#include <TinyGPS++.h>
+#include <TinyGPSUbx.h>
+
+#include <chrono>
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#if _GPS_FEATURES != _GPS_FEATURES_ALL
+#error "Build with all TinyGPSPlus features"
+#endif
+
+// Longest term of a parsed sentence
+static const size_t MAX_TERM = _GPS_MAX_FIELD_SIZE - 1;
+
+// Largest chunk handed to encode(buf, len), as gps_uart reads
+static const size_t MAX_CHUNK = 64;
+
+// Minimum time spent on each stream in the throughput check
+static const double MIN_RUN_SECONDS = 0.2;
+
+// Slowest allowed stream per byte, relative to clean NMEA
+static const double DEFAULT_MAX_SLOWDOWN = 3.0;
+
+// Seconds of clean NMEA for the throughput check
+static const uint32_t CLEAN_SECONDS = 1000;
+
+// Random bytes for the throughput check
+static const size_t NOISE_BYTES = 256 * 1024;
+
+// Tokens inserted by the mutator; tools/fuzz/nmea.dict has more for libFuzzer
+static const char *const TOKENS[] = {
+  "$", "*", ",", "\r\n", "$GPRMC,", "$GNGGA,", "$GPZDA,", "$GPGSV,", "$GPGSA,",
+  "$GPTXT,", "$PUBX,", ",A,", ",V,", ",N,", ",S,", ",E,", ",W,", "235960.99",
+  "9000.0000", "18000.0000", "5959.9999999", "311299", "00000000000000",
+  "4294967296", "-1", "\xB5\x62", "\xB5\x62\x01\x21\x14\x00", "\xB5\x62\x01\x07\x5C\x00",
+};
+
+enum FeedMode { NMEA_BYTES, NMEA_CHUNKS, UBX_BYTES, UBX_CHUNKS };
+
+/**
+ * A decoder as on the clock, with custom elements on a sentence that
+ * has no handler of its own and on a proprietary one
+ */
+struct Decoder {
+  TinyGPSPlus gps;
+  TinyGPSUbx ubx;
+  TinyGPSCustom gsa_mode;
+  TinyGPSCustom gsa_pdop;
+  TinyGPSCustom pubx_id;
+  TinyGPSCustom pubx_far; // beyond the custom slot table
+  size_t returned;        // sum of the encode() return values
+
+  Decoder()
+    : ubx(gps)
+    , gsa_mode(gps, "GPGSA", 2)
+    , gsa_pdop(gps, "GPGSA", 15)
+    , pubx_id(gps, "PUBX", 1)
+    , pubx_far(gps, "PUBX", 40)
+    , returned(0)
+  {}
+};
+
+struct RefDegrees {
+  uint16_t deg;
+  uint32_t billionths;
+  bool negative;
+};
+
+/**
+ * Reference parser state
+ */
+struct Reference {
+  // Results
+  uint32_t passed;
+  uint32_t failed;
+  uint32_t with_fix;
+  uint32_t counts[TinyGPSPlus::GPS_SENTENCE_TYPES];
+  uint32_t date_time_commits;
+  bool date_valid;
+  bool time_valid;
+  bool location_valid;
+  uint32_t date;
+  uint32_t time;
+  RefDegrees lat;
+  RefDegrees lng;
+
+  // Sentence being received
+  bool in_sentence;
+  bool in_checksum;
+  uint8_t parity;
+  std::string term;
+  uint32_t term_number;
+  int type;
+  bool has_fix;
+  bool has_time;
+  bool has_date;
+
+  // Values staged for the commit, kept from sentence to sentence
+  uint32_t new_date;
+  uint32_t new_time;
+  RefDegrees new_lat;
+  RefDegrees new_lng;
+};
+
+/**********************************************
+ * Function prototypes
+ **********************************************/
+uint32_t next_random(uint32_t &state);
+uint32_t input_hash(const uint8_t *data, size_t len);
+void feed(Decoder &d, FeedMode mode, const uint8_t *data, size_t len);
+std::string describe(Decoder &d);
+void check_input(const uint8_t *data, size_t len);
+void fail(const char *what, const uint8_t *data, size_t len, const std::string &a, const std::string &b);
+void ref_encode(Reference &r, uint8_t c);
+void ref_end_of_term(Reference &r, uint8_t c);
+void ref_reject(Reference &r);
+void ref_field(Reference &r);
+void ref_commit(Reference &r);
+int ref_sentence_type(const std::string &term);
+uint64_t ref_digits(const std::string &term, size_t &i);
+bool ref_time(const std::string &term, uint32_t &time);
+bool ref_degrees(const std::string &term, uint16_t max_deg, RefDegrees &deg);
+std::string describe_reference(const Reference &r);
+std::string describe_reference(TinyGPSPlus &gps);
+std::string nmea_sentence(const char *body);
+std::string make_clean_stream(uint32_t &state);
+std::string mutate(const std::vector<std::string> &inputs, uint32_t &state);
+void fix_checksums(std::string &s);
+bool load_file(const char *path, std::string &data);
+double seconds_per_byte(const std::string &data, uint32_t &passed, uint32_t &failed);
+
+
+/**
+ * libFuzzer entry point
+ */
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+  check_input(data, size);
+  return 0;
+}
+
+
+#if !defined(FUZZ_LIBFUZZER)
+/*********************************************/
+int main(int argc, char *argv[])
+{
+  long mutations = 0;
+  bool throughput = false;
+  double max_slowdown = DEFAULT_MAX_SLOWDOWN;
+  std::vector<std::string> names;
+  std::vector<std::string> inputs;
+
+  for (int i = 1; i < argc; i++)
+  {
+    if (strcmp(argv[i], "-m") == 0 && i + 1 < argc)
+    {
+      mutations = atol(argv[++i]);
+    }
+    else if (strcmp(argv[i], "-t") == 0)
+    {
+      throughput = true;
+    }
+    else if (strcmp(argv[i], "-r") == 0 && i + 1 < argc)
+    {
+      max_slowdown = atof(argv[++i]);
+    }
+    else if (argv[i][0] == '-')
+    {
+      fprintf(stderr, "Usage: %s [-m COUNT | -t [-r MAX]] [FILE...]\n", argv[0]);
+      return 2;
+    }
+    else
+    {
+      std::string data;
+      if (!load_file(argv[i], data))
+      {
+        fprintf(stderr, "Can't read %s\n", argv[i]);
+        return 1;
+      }
+      const char *name = strrchr(argv[i], '/');
+      names.push_back(name ? name + 1 : argv[i]);
+      inputs.push_back(data);
+    }
+  }
+
+  uint32_t state = 2463534242UL;
+
+  if (throughput)
+  {
+    names.insert(names.begin(), "random bytes");
+    std::string noise;
+    for (size_t i = 0; i < NOISE_BYTES; i++)
+    {
+      noise += (char)next_random(state);
+    }
+    inputs.insert(inputs.begin(), noise);
+
+    uint32_t passed, failed;
+    std::string stream = make_clean_stream(state);
+    double clean = seconds_per_byte(stream, passed, failed);
+    printf("%-24s %9s %9s %9s %8s %8s\n", "stream", "bytes", "MB/s", "slowdown", "passed", "failed");
+    printf("%-24s %9zu %9.1f %9.2f %8u %8u\n", "clean NMEA", stream.size(), 1e-6 / clean, 1.0, passed, failed);
+
+    bool ok = true;
+    for (size_t i = 0; i < inputs.size(); i++)
+    {
+      if (inputs[i].empty())
+      {
+        continue;
+      }
+      double t = seconds_per_byte(inputs[i], passed, failed);
+      bool slow = t > max_slowdown * clean;
+      ok = ok && !slow;
+      printf("%-24s %9zu %9.1f %9.2f %8u %8u%s\n", names[i].c_str(), inputs[i].size(),
+             1e-6 / t, t / clean, passed, failed, slow ? "  TOO SLOW" : "");
+    }
+    return ok ? 0 : 1;
+  }
+
+  if (inputs.empty())
+  {
+    // One input on stdin, as AFL runs it
+    std::string data;
+    if (!load_file("/dev/stdin", data))
+    {
+      return 1;
+    }
+    inputs.push_back(data);
+  }
+
+  for (const std::string &input : inputs)
+  {
+    check_input((const uint8_t *)input.data(), input.size());
+  }
+
+  for (long i = 0; i < mutations; i++)
+  {
+    std::string input = mutate(inputs, state);
+    check_input((const uint8_t *)input.data(), input.size());
+  }
+
+  printf("%zu inputs and %ld mutations OK\n", inputs.size(), mutations);
+  return 0;
+}
+#endif
+
+
+/**
+ * Small deterministic PRNG
+ */
+uint32_t next_random(uint32_t &state)
+{
+  state ^= state << 13;
+  state ^= state >> 17;
+  state ^= state << 5;
+  return state;
+}
+
+
+/**
+ * FNV-1a, to derive the chunk sizes from the input
+ */
+uint32_t input_hash(const uint8_t *data, size_t len)
+{
+  uint32_t hash = 2166136261UL;
+  for (size_t i = 0; i < len; i++)
+  {
+    hash = (hash ^ data[i]) * 16777619UL;
+  }
+  return hash | 1; // never 0, the PRNG would stick
+}
+
+
+/**
+ * Decode the input
+ * @param mode: through TinyGPSPlus or TinyGPSUbx, bytes or chunks
+ */
+void feed(Decoder &d, FeedMode mode, const uint8_t *data, size_t len)
+{
+  if (mode == NMEA_BYTES || mode == UBX_BYTES)
+  {
+    for (size_t i = 0; i < len; i++)
+    {
+      if (mode == NMEA_BYTES ? d.gps.encode((char)data[i]) : d.ubx.encode((char)data[i]))
+      {
+        d.returned++;
+      }
+    }
+    return;
+  }
+
+  uint32_t state = input_hash(data, len);
+  size_t i = 0;
+  while (i < len)
+  {
+    size_t chunk = 1 + next_random(state) % MAX_CHUNK;
+    if (chunk > len - i)
+    {
+      chunk = len - i;
+    }
+    const char *buf = (const char *)data + i;
+    d.returned += mode == NMEA_CHUNKS ? d.gps.encode(buf, chunk) : d.ubx.encode(buf, chunk);
+    i += chunk;
+  }
+}
+
+
+/**
+ * Everything a user of the decoder can see, apart from the times
+ */
+std::string describe(Decoder &d)
+{
+  TinyGPSPlus &gps = d.gps;
+  std::string s;
+  char line[256];
+
+  snprintf(line, sizeof(line), "chars %u passed %u failed %u with fix %u returned %zu\n",
+           gps.charsProcessed(), gps.passedChecksum(), gps.failedChecksum(),
+           gps.sentencesWithFix(), d.returned);
+  s += line;
+  for (uint8_t i = 0; i < TinyGPSPlus::GPS_SENTENCE_TYPES; i++)
+  {
+    snprintf(line, sizeof(line), "%s %u\n", TinyGPSPlus::sentenceTypeName(i), gps.sentenceCount(i));
+    s += line;
+  }
+
+  snprintf(line, sizeof(line), "date %d %u time %d %u\n",
+           gps.date.isValid(), gps.date.value(), gps.time.isValid(), gps.time.value());
+  s += line;
+
+  const TinyGPSDateTime &dt = gps.dateTime();
+  snprintf(line, sizeof(line), "date time %u-%u-%u %u:%u:%u.%u #%u\n",
+           dt.year, dt.month, dt.day, dt.hour, dt.minute, dt.second, dt.centisecond, dt.sequence);
+  s += line;
+
+  const RawDegrees &lat = gps.location.rawLat();
+  const RawDegrees &lng = gps.location.rawLng();
+  snprintf(line, sizeof(line), "location %d %d %u.%09u %d %u.%09u quality %d mode %d\n",
+           gps.location.isValid(), lat.negative, lat.deg, lat.billionths,
+           lng.negative, lng.deg, lng.billionths,
+           (int)gps.location.FixQuality(), (int)gps.location.FixMode());
+  s += line;
+
+  snprintf(line, sizeof(line), "speed %d %d course %d %d altitude %d %d satellites %d %u hdop %d %d\n",
+           gps.speed.isValid(), (int)gps.speed.value(), gps.course.isValid(), (int)gps.course.value(),
+           gps.altitude.isValid(), (int)gps.altitude.value(), gps.satellites.isValid(),
+           gps.satellites.value(), gps.hdop.isValid(), (int)gps.hdop.value());
+  s += line;
+
+  snprintf(line, sizeof(line), "in view %d %u\n", gps.satellitesInView.isValid(), gps.satellitesInView.count());
+  s += line;
+  for (uint8_t i = 0; i < gps.satellitesInView.count(); i++)
+  {
+    snprintf(line, sizeof(line), "  %d %u %u %u %u\n", (int)gps.satellitesInView.constellation(i),
+             gps.satellitesInView.prn(i), gps.satellitesInView.elevation(i),
+             gps.satellitesInView.azimuth(i), gps.satellitesInView.snr(i));
+    s += line;
+  }
+
+  TinyGPSCustom *customs[] = {&d.gsa_mode, &d.gsa_pdop, &d.pubx_id, &d.pubx_far};
+  for (TinyGPSCustom *custom : customs)
+  {
+    snprintf(line, sizeof(line), "custom %d '%s'\n", custom->isValid(), custom->value());
+    s += line;
+  }
+
+  snprintf(line, sizeof(line), "ubx frames %u failed %u ack %d %u %u #%u\n",
+           d.ubx.framesProcessed(), d.ubx.failedChecksum(), (int)d.ubx.lastAck(),
+           d.ubx.lastAckClass(), d.ubx.lastAckId(), d.ubx.ackSequence());
+  s += line;
+
+  return s;
+}
+
+
+/**
+ * Decode one input all ways and compare
+ */
+void check_input(const uint8_t *data, size_t len)
+{
+  Decoder nmea_bytes, nmea_chunks, ubx_bytes, ubx_chunks;
+  feed(nmea_bytes, NMEA_BYTES, data, len);
+  feed(nmea_chunks, NMEA_CHUNKS, data, len);
+  feed(ubx_bytes, UBX_BYTES, data, len);
+  feed(ubx_chunks, UBX_CHUNKS, data, len);
+
+  // encode(char) returns whether a sentence or frame passed, encode(buf, len) how many
+  if (nmea_bytes.returned != nmea_bytes.gps.passedChecksum()
+      || ubx_bytes.returned != ubx_bytes.ubx.framesProcessed())
+  {
+    fail("encode(char) return value", data, len, describe(nmea_bytes), describe(ubx_bytes));
+  }
+  ubx_bytes.returned += ubx_bytes.gps.passedChecksum();
+
+  std::string a = describe(nmea_bytes);
+  std::string b = describe(nmea_chunks);
+  if (a != b)
+  {
+    fail("TinyGPSPlus bytes vs chunks", data, len, a, b);
+  }
+
+  a = describe(ubx_bytes);
+  b = describe(ubx_chunks);
+  if (a != b)
+  {
+    fail("TinyGPSUbx bytes vs chunks", data, len, a, b);
+  }
+
+  Reference ref = Reference();
+  for (size_t i = 0; i < len; i++)
+  {
+    ref_encode(ref, data[i]);
+  }
+  a = describe_reference(ref);
+  b = describe_reference(nmea_bytes.gps);
+  if (a != b)
+  {
+    fail("reference vs TinyGPSPlus", data, len, a, b);
+  }
+}
+
+
+/**
+ * Print the input and both sides of a mismatch, and abort for the fuzzer
+ */
+void fail(const char *what, const uint8_t *data, size_t len, const std::string &a, const std::string &b)
+{
+  fprintf(stderr, "Mismatch: %s\nInput (%zu bytes):\n", what, len);
+  for (size_t i = 0; i < len; i++)
+  {
+    if (data[i] >= ' ' && data[i] <= '~' && data[i] != '\\')
+    {
+      fputc(data[i], stderr);
+    }
+    else
+    {
+      fprintf(stderr, data[i] == '\n' ? "\\n\n" : "\\x%02X", data[i]);
+    }
+  }
+  fprintf(stderr, "\n--- expected\n%s--- got\n%s", a.c_str(), b.c_str());
+  abort();
+}
+
+
+/**********************************************
+ * Reference parser
+ **********************************************/
+void ref_encode(Reference &r, uint8_t c)
+{
+  if (c == '$')
+  {
+    r.in_sentence = true;
+    r.in_checksum = false;
+    r.parity = 0;
+    r.term.clear();
+    r.term_number = 0;
+    r.type = TinyGPSPlus::GPS_SENTENCE_OTHER;
+    r.has_fix = false;
+    r.has_time = false;
+    r.has_date = false;
+    return;
+  }
+
+  if (!r.in_sentence)
+  {
+    return;
+  }
+
+  if (c == ',' || c == '*' || c == '\r' || c == '\n')
+  {
+    ref_end_of_term(r, c);
+  }
+  else if (c < ' ' || c > '~')
+  {
+    ref_reject(r);
+  }
+  else
+  {
+    r.term += (char)c;
+    if (!r.in_checksum)
+    {
+      r.parity ^= c;
+    }
+  }
+}
+
+
+void ref_end_of_term(Reference &r, uint8_t c)
+{
+  bool parsed = r.type != TinyGPSPlus::GPS_SENTENCE_TXT && r.type != TinyGPSPlus::GPS_SENTENCE_OTHER;
+
+  if (c == ',' && !r.in_checksum)
+  {
+    r.parity ^= c;
+  }
+
+  if (parsed && r.term.size() > MAX_TERM)
+  {
+    ref_reject(r);
+  }
+  else if (r.term_number >= 255)
+  {
+    ref_reject(r);
+  }
+  else if ((c == '\r' || c == '\n') && !r.in_checksum)
+  {
+    ref_reject(r);
+  }
+  else if (r.in_checksum)
+  {
+    const std::string &t = r.term;
+    bool hex = t.size() == 2 && isxdigit((unsigned char)t[0]) && isxdigit((unsigned char)t[1]);
+    r.in_sentence = false;
+    if (hex && strtoul(t.c_str(), 0, 16) == r.parity)
+    {
+      ref_commit(r);
+    }
+    else
+    {
+      r.failed++;
+    }
+  }
+  else
+  {
+    ref_field(r);
+  }
+
+  r.term.clear();
+  r.term_number++;
+  r.in_checksum = c == '*';
+}
+
+
+void ref_reject(Reference &r)
+{
+  r.in_sentence = false;
+  r.failed++;
+}
+
+
+/**
+ * Stage a value, or reject the sentence if it is out of range
+ */
+void ref_field(Reference &r)
+{
+  const std::string &t = r.term;
+  uint32_t n = r.term_number;
+  size_t i = 0;
+  bool ok = true;
+
+  if (n == 0)
+  {
+    r.type = ref_sentence_type(t);
+    if (r.type == TinyGPSPlus::GPS_SENTENCE_ZDA)
+    {
+      r.new_date = 0;
+    }
+    return;
+  }
+  if (t.empty())
+  {
+    return;
+  }
+
+  switch (r.type)
+  {
+    case TinyGPSPlus::GPS_SENTENCE_RMC:
+      if (n == 1) ok = r.has_time = ref_time(t, r.new_time);
+      if (n == 2) r.has_fix = t[0] == 'A';
+      if (n == 3) ok = ref_degrees(t, 90, r.new_lat);
+      if (n == 4) r.new_lat.negative = t[0] == 'S';
+      if (n == 5) ok = ref_degrees(t, 180, r.new_lng);
+      if (n == 6) r.new_lng.negative = t[0] == 'W';
+      if (n == 9)
+      {
+        uint64_t d = ref_digits(t, i);
+        uint64_t day = d / 10000, month = d / 100 % 100;
+        ok = day >= 1 && day <= 31 && month >= 1 && month <= 12;
+        if (ok) r.new_date = (uint32_t)d;
+        r.has_date = ok;
+      }
+      break;
+
+    case TinyGPSPlus::GPS_SENTENCE_GGA:
+      if (n == 1) ok = r.has_time = ref_time(t, r.new_time);
+      if (n == 2) ok = ref_degrees(t, 90, r.new_lat);
+      if (n == 3) r.new_lat.negative = t[0] == 'S';
+      if (n == 4) ok = ref_degrees(t, 180, r.new_lng);
+      if (n == 5) r.new_lng.negative = t[0] == 'W';
+      if (n == 6) r.has_fix = t[0] > '0';
+      break;
+
+    case TinyGPSPlus::GPS_SENTENCE_ZDA:
+      if (n == 1) ok = r.has_time = ref_time(t, r.new_time);
+      if (n == 2)
+      {
+        uint64_t day = ref_digits(t, i);
+        ok = day >= 1 && day <= 31;
+        if (ok) r.new_date = (uint32_t)day * 10000;
+      }
+      if (n == 3)
+      {
+        uint64_t month = ref_digits(t, i);
+        ok = month >= 1 && month <= 12;
+        if (ok) r.new_date += (uint32_t)month * 100;
+      }
+      if (n == 4)
+      {
+        uint64_t year = ref_digits(t, i);
+        ok = year >= 2000 && year <= 2099;
+        if (ok) r.new_date += (uint32_t)year % 100;
+        r.has_date = ok && r.new_date / 10000 != 0 && r.new_date / 100 % 100 != 0;
+      }
+      break;
+  }
+
+  if (!ok)
+  {
+    ref_reject(r);
+  }
+}
+
+
+/**
+ * A sentence passed the checksum
+ */
+void ref_commit(Reference &r)
+{
+  r.passed++;
+  r.counts[r.type]++;
+  if (r.has_fix)
+  {
+    r.with_fix++;
+  }
+
+  // Only the fields this sentence had; ZDA commits both or nothing
+  bool rmc = r.type == TinyGPSPlus::GPS_SENTENCE_RMC;
+  bool zda = r.type == TinyGPSPlus::GPS_SENTENCE_ZDA && r.has_time && r.has_date;
+  bool date = r.has_date && (rmc || zda);
+  bool time = r.has_time && (rmc || zda || r.type == TinyGPSPlus::GPS_SENTENCE_GGA);
+  bool location = r.has_fix && (r.type == TinyGPSPlus::GPS_SENTENCE_RMC
+                                || r.type == TinyGPSPlus::GPS_SENTENCE_GGA);
+
+  if (date)
+  {
+    r.date = r.new_date;
+    r.date_valid = true;
+  }
+  if (date && time)
+  {
+    r.date_time_commits++;
+  }
+  if (time)
+  {
+    r.time = r.new_time;
+    r.time_valid = true;
+  }
+  if (location)
+  {
+    r.lat = r.new_lat;
+    r.lng = r.new_lng;
+    r.location_valid = true;
+  }
+}
+
+
+/**
+ * Sentence type from the first term, e.g. "GNRMC"
+ */
+int ref_sentence_type(const std::string &term)
+{
+  static const char *const talkers[] = {"GP", "GN", "GA", "GB", "GL"};
+  static const char *const types[] = {"GGA", "RMC", "GSV", "GSA", "VTG", "ZDA", "GLL", "TXT"};
+
+  if (term.size() != 5)
+  {
+    return TinyGPSPlus::GPS_SENTENCE_OTHER;
+  }
+  for (const char *talker : talkers)
+  {
+    if (term.compare(0, 2, talker) == 0)
+    {
+      for (int type = 0; type < (int)(sizeof(types) / sizeof(types[0])); type++)
+      {
+        if (term.compare(2, 3, types[type]) == 0)
+        {
+          return type;
+        }
+      }
+    }
+  }
+  return TinyGPSPlus::GPS_SENTENCE_OTHER;
+}
+
+
+/**
+ * Value of the digits from term[i] on; i is left after them.
+ * Terms of parsed sentences have at most 14 digits.
+ */
+uint64_t ref_digits(const std::string &term, size_t &i)
+{
+  uint64_t value = 0;
+  for (; i < term.size() && isdigit((unsigned char)term[i]); i++)
+  {
+    value = 10 * value + (term[i] - '0');
+  }
+  return value;
+}
+
+
+/**
+ * hhmmss.cc as hhmmsscc
+ */
+bool ref_time(const std::string &term, uint32_t &time)
+{
+  size_t i = term[0] == '-' ? 1 : 0;
+  bool negative = i == 1;
+  uint64_t value = 100 * ref_digits(term, i);
+
+  if (i + 1 < term.size() && term[i] == '.' && isdigit((unsigned char)term[i + 1]))
+  {
+    value += 10 * (term[i + 1] - '0');
+    if (i + 2 < term.size() && isdigit((unsigned char)term[i + 2]))
+    {
+      value += term[i + 2] - '0';
+    }
+  }
+
+  if ((negative && value > 0) || value / 1000000 >= 24 || value / 10000 % 100 >= 60 || value / 100 % 100 > 60)
+  {
+    return false;
+  }
+  time = (uint32_t)value;
+  return true;
+}
+
+
+/**
+ * DDDMM.MMMM up to max_deg degrees, with the billionths of a degree
+ * rounded as TinyGPSPlus does
+ */
+bool ref_degrees(const std::string &term, uint16_t max_deg, RefDegrees &deg)
+{
+  size_t i = 0;
+  uint64_t value = ref_digits(term, i);
+  uint64_t degrees = value / 100;
+  uint64_t ten_millionths = value % 100 * 10000000;
+
+  if (value % 100 >= 60)
+  {
+    return false;
+  }
+
+  if (i < term.size() && term[i] == '.')
+  {
+    uint64_t place = 10000000;
+    for (i++; i < term.size() && isdigit((unsigned char)term[i]); i++)
+    {
+      place /= 10;
+      ten_millionths += (term[i] - '0') * place;
+    }
+  }
+
+  uint64_t billionths = (5 * ten_millionths + 1) / 3;
+  if (degrees > max_deg || (degrees == max_deg && billionths > 0))
+  {
+    return false;
+  }
+
+  deg.deg = (uint16_t)degrees;
+  deg.billionths = (uint32_t)billionths;
+  deg.negative = false;
+  return true;
+}
+
+
+/**
+ * What the reference parser checks, from both sides
+ */
+std::string describe_reference(const Reference &r)
+{
+  std::string s;
+  char line[160];
+
+  snprintf(line, sizeof(line), "passed %u failed %u with fix %u\n", r.passed, r.failed, r.with_fix);
+  s += line;
+  for (uint8_t i = 0; i < TinyGPSPlus::GPS_SENTENCE_TYPES; i++)
+  {
+    snprintf(line, sizeof(line), "%s %u\n", TinyGPSPlus::sentenceTypeName(i), r.counts[i]);
+    s += line;
+  }
+  snprintf(line, sizeof(line), "date %d %u time %d %u #%u\n",
+           r.date_valid, r.date, r.time_valid, r.time, r.date_time_commits);
+  s += line;
+  snprintf(line, sizeof(line), "location %d %d %u.%09u %d %u.%09u\n", r.location_valid,
+           r.lat.negative, r.lat.deg, r.lat.billionths, r.lng.negative, r.lng.deg, r.lng.billionths);
+  s += line;
+  return s;
+}
+
+
+std::string describe_reference(TinyGPSPlus &gps)
+{
+  Reference r = Reference();
+  r.passed = gps.passedChecksum();
+  r.failed = gps.failedChecksum();
+  r.with_fix = gps.sentencesWithFix();
+  for (uint8_t i = 0; i < TinyGPSPlus::GPS_SENTENCE_TYPES; i++)
+  {
+    r.counts[i] = gps.sentenceCount(i);
+  }
+  r.date_valid = gps.date.isValid();
+  r.date = gps.date.value();
+  r.time_valid = gps.time.isValid();
+  r.time = gps.time.value();
+  r.date_time_commits = gps.dateTime().sequence;
+  r.location_valid = gps.location.isValid();
+  const RawDegrees &lat = gps.location.rawLat();
+  const RawDegrees &lng = gps.location.rawLng();
+  r.lat.deg = lat.deg;
+  r.lat.billionths = lat.billionths;
+  r.lat.negative = lat.negative;
+  r.lng.deg = lng.deg;
+  r.lng.billionths = lng.billionths;
+  r.lng.negative = lng.negative;
+  return describe_reference(r);
+}
+
+
+/**********************************************
+ * Inputs
+ **********************************************/
+
+/**
+ * Wrap a sentence body ("GPRMC,...") with '$', checksum and CR/LF
+ */
+std::string nmea_sentence(const char *body)
+{
+  uint8_t parity = 0;
+  for (const char *p = body; *p; p++)
+  {
+    parity ^= (uint8_t)*p;
+  }
+
+  char tail[8];
+  snprintf(tail, sizeof(tail), "*%02X\r\n", parity);
+  return std::string("$") + body + tail;
+}
+
+
+/**
+ * A NEO-6M like stream: RMC, VTG, GGA, GSA, three GSV and GLL every second
+ */
+std::string make_clean_stream(uint32_t &state)
+{
+  std::string s;
+  char body[96];
+
+  for (uint32_t t = 0; t < CLEAN_SECONDS; t++)
+  {
+    unsigned hh = t / 3600 % 24, mm = t / 60 % 60, ss = t % 60;
+    unsigned lat = next_random(state) % 100000, lng = next_random(state) % 100000;
+
+    snprintf(body, sizeof(body), "GPRMC,%02u%02u%02u.00,A,5922.%05u,N,02445.%05u,E,0.%03u,,160326,,,A",
+             hh, mm, ss, lat, lng, next_random(state) % 1000);
+    s += nmea_sentence(body);
+    snprintf(body, sizeof(body), "GPVTG,,T,,M,0.%03u,N,0.%03u,K,A",
+             next_random(state) % 1000, next_random(state) % 1000);
+    s += nmea_sentence(body);
+    snprintf(body, sizeof(body), "GPGGA,%02u%02u%02u.00,5922.%05u,N,02445.%05u,E,1,%02u,1.%02u,41.%u,M,18.9,M,,",
+             hh, mm, ss, lat, lng, 4 + next_random(state) % 8, next_random(state) % 100,
+             next_random(state) % 10);
+    s += nmea_sentence(body);
+    s += nmea_sentence("GPGSA,A,3,05,13,15,18,20,24,29,,,,,,2.51,1.27,2.16");
+    for (int part = 1; part <= 3; part++)
+    {
+      snprintf(body, sizeof(body), "GPGSV,3,%d,11,%02u,%02u,%03u,%02u,%02u,%02u,%03u,%02u,%02u,%02u,%03u,%02u",
+               part, 1 + next_random(state) % 32, next_random(state) % 90, next_random(state) % 360,
+               next_random(state) % 50, 1 + next_random(state) % 32, next_random(state) % 90,
+               next_random(state) % 360, next_random(state) % 50, 1 + next_random(state) % 32,
+               next_random(state) % 90, next_random(state) % 360, next_random(state) % 50);
+      s += nmea_sentence(body);
+    }
+    snprintf(body, sizeof(body), "GPGLL,5922.%05u,N,02445.%05u,E,%02u%02u%02u.00,A,A", lat, lng, hh, mm, ss);
+    s += nmea_sentence(body);
+  }
+  return s;
+}
+
+
+/**
+ * A random mutation of one of the inputs; half of them get valid
+ * checksums so that the values behind the checksum test are reached
+ */
+std::string mutate(const std::vector<std::string> &inputs, uint32_t &state)
+{
+  std::string s = inputs[next_random(state) % inputs.size()];
+  int count = 1 + next_random(state) % 8;
+
+  for (int i = 0; i < count; i++)
+  {
+    size_t pos = s.empty() ? 0 : next_random(state) % (s.size() + 1);
+    size_t len = 1 + next_random(state) % 32;
+
+    switch (next_random(state) % 7)
+    {
+      case 0: // flip a bit
+        if (pos < s.size())
+        {
+          s[pos] ^= 1 << next_random(state) % 8;
+        }
+        break;
+      case 1: // a random byte
+        s.insert(pos, 1, (char)next_random(state));
+        break;
+      case 2: // a token
+        s.insert(pos, TOKENS[next_random(state) % (sizeof(TOKENS) / sizeof(TOKENS[0]))]);
+        break;
+      case 3: // cut
+        s.erase(pos, len);
+        break;
+      case 4: // repeat
+        s.insert(pos, s.substr(pos, len));
+        break;
+      case 5: // a run of digits, e.g. an overlong field
+        for (size_t j = 0; j < len; j++)
+        {
+          s.insert(pos, 1, (char)('0' + next_random(state) % 10));
+        }
+        break;
+      case 6: // splice in a piece of another input
+        {
+          const std::string &other = inputs[next_random(state) % inputs.size()];
+          if (!other.empty())
+          {
+            s.insert(pos, other.substr(next_random(state) % other.size(), 4 * len));
+          }
+        }
+        break;
+    }
+  }
+
+  if (next_random(state) % 2)
+  {
+    fix_checksums(s);
+  }
+  return s;
+}
+
+
+/**
+ * Correct the two characters after the '*' of every sentence
+ */
+void fix_checksums(std::string &s)
+{
+  for (size_t start = s.find('$'); start != std::string::npos; start = s.find('$', start + 1))
+  {
+    uint8_t parity = 0;
+    size_t i = start + 1;
+    for (; i < s.size() && s[i] != '*' && s[i] != '$'; i++)
+    {
+      parity ^= (uint8_t)s[i];
+    }
+    if (i + 2 < s.size() && s[i] == '*')
+    {
+      static const char hex[] = "0123456789ABCDEF";
+      s[i + 1] = hex[parity >> 4];
+      s[i + 2] = hex[parity & 0x0F];
+    }
+  }
+}
+
+
+bool load_file(const char *path, std::string &data)
+{
+  FILE *file = fopen(path, "rb");
+  if (!file)
+  {
+    return false;
+  }
+
+  char buffer[4096];
+  size_t len;
+  while ((len = fread(buffer, 1, sizeof(buffer), file)) > 0)
+  {
+    data.append(buffer, len);
+  }
+  fclose(file);
+  return true;
+}
+
+
+/**
+ * Decode a stream in MAX_CHUNK byte chunks through TinyGPSUbx, as
+ * run_gps() does, until MIN_RUN_SECONDS have passed
+ * @param passed, failed: NMEA checksum counts of one pass
+ * @return seconds per byte
+ */
+double seconds_per_byte(const std::string &data, uint32_t &passed, uint32_t &failed)
+{
+  typedef std::chrono::steady_clock Clock;
+  Clock::time_point start = Clock::now();
+  double seconds = 0;
+  uint64_t bytes = 0;
+
+  do
+  {
+    TinyGPSPlus gps;
+    TinyGPSUbx ubx(gps);
+    for (size_t i = 0; i < data.size(); i += MAX_CHUNK)
+    {
+      size_t chunk = data.size() - i < MAX_CHUNK ? data.size() - i : MAX_CHUNK;
+      ubx.encode(data.data() + i, chunk);
+    }
+    bytes += data.size();
+    passed = gps.passedChecksum();
+    failed = gps.failedChecksum();
+    seconds = std::chrono::duration<double>(Clock::now() - start).count();
+  } while (seconds < MIN_RUN_SECONDS);
+
+  return seconds / bytes;
+}
@@ -0,0 +1,361 @@
+/**
+ *
+ * Accuracy and speed of the integer location API of TinyGPSPlus
+ * Started: 16.10.2026
+ * Tauno Erik
+ *
+ * Compares distanceBetweenE7() and courseToE7() with the double versions
+ * distanceBetween() and courseTo() on random pairs of points in distance
+ * bands from a few metres to the other side of the earth, plus the
+ * antimeridian, the poles and antipodes, and latE7()/lngE7() with lat()
+ * and lng() on parsed sentences. Prints the largest errors and the time
+ * per call, and fails if an error is over the bounds documented in
+ * TinyGPS++.h.
+ *
+ * The times are the host's, where double math has hardware support and
+ * the integer versions are the slower ones. On the ESP8266 double math
+ * runs in software floating point; the two have not been timed there.
+ *
+ * Build (from the repository root):
+ *   g++ -O2 -std=c++11 -Ilib/TinyGPSPlus-master/src \
+ *       tools/geo_bench/geo_bench.cpp \
+ *       lib/TinyGPSPlus-master/src/TinyGPS++.cpp -o geo_bench
+ *
+ * Usage:
+ *   ./geo_bench
+ *
+ */
+#include <TinyGPS++.h>
+
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#if _GPS_FEATURES != _GPS_FEATURES_ALL
+#error "Build with all TinyGPSPlus features"
+#endif
+
+// Random pairs of points in each band
+static const int PAIRS_PER_BAND = 200000;
+
+// Sentences for the latE7()/lngE7() check
+static const int SENTENCES = 100000;
+
+// Minimum wall time spent on each timing
+static const double MIN_RUN_SECONDS = 0.25;
+
+// Bounds from TinyGPS++.h
+static const double MAX_DISTANCE_ERROR = 1.0; // metres, of which 0.5 is the rounding to metres
+static const double MAX_COURSE_ERROR = 0.25;  // metres sideways at the destination
+
+struct Band {
+  const char *name;
+  double min_m;
+  double max_m;
+};
+
+static const Band BANDS[] = {
+  {"0 - 100 m", 0, 100},
+  {"100 m - 10 km", 100, 10000},
+  {"10 - 111 km", 10000, 111000},
+  {"111 - 1000 km", 111000, 1000000},
+  {"1000 - 20000 km", 1000000, 20000000},
+};
+
+struct Point {
+  int32_t lat;
+  int32_t lng;
+};
+
+struct Pair {
+  Point a;
+  Point b;
+};
+
+struct Errors {
+  double distance;  // largest, metres
+  double relative;  // largest, relative to the distance
+  double course;    // largest, metres sideways at the destination
+  bool ok;
+};
+
+/**********************************************
+ * Function prototypes
+ **********************************************/
+uint32_t next_random(uint32_t &state);
+double uniform(uint32_t &state, double min, double max);
+Point destination(double lat, double lng, double bearing, double metres);
+std::vector<Pair> make_band(const Band &band, uint32_t &state);
+std::vector<Pair> make_edge_cases(uint32_t &state);
+Errors check_pairs(const std::vector<Pair> &pairs);
+bool check_location(uint32_t &state);
+void time_calls(const char *name, const std::vector<Pair> &pairs);
+
+
+/*********************************************/
+int main()
+{
+  uint32_t state = 2463534242UL;
+  bool ok = true;
+
+  printf("%-20s %12s %12s %14s\n", "band", "distance m", "relative", "course m");
+  for (const Band &band : BANDS)
+  {
+    Errors e = check_pairs(make_band(band, state));
+    printf("%-20s %12.3f %12.2e %14.3f%s\n", band.name, e.distance, e.relative, e.course,
+           e.ok ? "" : "  OVER THE BOUND");
+    ok = ok && e.ok;
+  }
+  Errors e = check_pairs(make_edge_cases(state));
+  printf("%-20s %12.3f %12.2e %14.3f%s\n", "edge cases", e.distance, e.relative, e.course,
+         e.ok ? "" : "  OVER THE BOUND");
+  ok = ok && e.ok;
+
+  bool location = check_location(state);
+  printf("latE7(), lngE7()     %s\n\n", location ? "match lat(), lng()" : "DIFFER from lat(), lng()");
+  ok = ok && location;
+
+  std::vector<Pair> pairs = make_band(BANDS[2], state);
+  std::vector<Pair> far = make_band(BANDS[4], state);
+  pairs.resize(1000);
+  far.resize(1000);
+  printf("%-20s %14s %14s %14s\n", "ns per call", "double", "integer", "integer/double");
+  time_calls("  10 - 111 km", pairs);
+  time_calls("  1000 - 20000 km", far);
+
+  return ok ? 0 : 1;
+}
+
+
+/**
+ * Small deterministic PRNG
+ */
+uint32_t next_random(uint32_t &state)
+{
+  state ^= state << 13;
+  state ^= state >> 17;
+  state ^= state << 5;
+  return state;
+}
+
+
+double uniform(uint32_t &state, double min, double max)
+{
+  return min + (max - min) * (next_random(state) / 4294967296.0);
+}
+
+
+/**
+ * The point at a distance and bearing on the sphere of TinyGPSPlus,
+ * rounded to 1e-7 degrees
+ */
+Point destination(double lat, double lng, double bearing, double metres)
+{
+  double d = metres / _GPS_EARTH_MEAN_RADIUS;
+  double lat1 = radians(lat), b = radians(bearing);
+  double lat2 = asin(sin(lat1) * cos(d) + cos(lat1) * sin(d) * cos(b));
+  double lng2 = radians(lng) + atan2(sin(b) * sin(d) * cos(lat1), cos(d) - sin(lat1) * sin(lat2));
+  lng2 = fmod(degrees(lng2) + 540.0, 360.0) - 180.0;
+
+  Point p;
+  p.lat = (int32_t)lround(degrees(lat2) * 1e7);
+  p.lng = (int32_t)lround(lng2 * 1e7);
+  if (p.lng >= 1800000000L)
+  {
+    p.lng -= 1800000000L * 2;
+  }
+  return p;
+}
+
+
+std::vector<Pair> make_band(const Band &band, uint32_t &state)
+{
+  std::vector<Pair> pairs;
+  for (int i = 0; i < PAIRS_PER_BAND; i++)
+  {
+    // Up to 85 degrees; closer to the poles in the edge cases
+    double lat = uniform(state, -85, 85);
+    double lng = uniform(state, -180, 180);
+    Pair p;
+    p.a.lat = (int32_t)lround(lat * 1e7);
+    p.a.lng = (int32_t)lround(lng * 1e7);
+    p.b = destination(lat, lng, uniform(state, 0, 360), uniform(state, band.min_m, band.max_m));
+    pairs.push_back(p);
+  }
+  return pairs;
+}
+
+
+std::vector<Pair> make_edge_cases(uint32_t &state)
+{
+  std::vector<Pair> pairs;
+  for (int i = 0; i < PAIRS_PER_BAND / 10; i++)
+  {
+    Pair p;
+
+    // Across the antimeridian
+    p.a.lat = (int32_t)uniform(state, -850000000, 850000000);
+    p.a.lng = 1800000000L - (int32_t)uniform(state, 0, 5000000);
+    p.b.lat = p.a.lat + (int32_t)uniform(state, -5000000, 5000000);
+    p.b.lng = -1800000000L + (int32_t)uniform(state, 0, 5000000);
+    pairs.push_back(p);
+
+    // Near the poles
+    p.a.lat = (int32_t)uniform(state, 890000000, 900000000);
+    p.a.lng = (int32_t)uniform(state, -1800000000, 1800000000);
+    p.b.lat = (int32_t)uniform(state, 890000000, 900000000);
+    p.b.lng = (int32_t)uniform(state, -1800000000, 1800000000);
+    if (i % 2)
+    {
+      p.a.lat = -p.a.lat;
+      p.b.lat = -p.b.lat;
+    }
+    pairs.push_back(p);
+
+    // Nearly antipodes
+    p.a.lat = (int32_t)uniform(state, -900000000, 900000000);
+    p.a.lng = (int32_t)uniform(state, -1800000000, 0);
+    p.b.lat = -p.a.lat + (int32_t)uniform(state, -100000, 100000);
+    p.b.lng = p.a.lng + 1800000000L + (int32_t)uniform(state, -100000, 0);
+    pairs.push_back(p);
+
+    // The same point
+    p.b = p.a;
+    pairs.push_back(p);
+  }
+  return pairs;
+}
+
+
+/**
+ * Largest errors of the integer versions against the double versions
+ */
+Errors check_pairs(const std::vector<Pair> &pairs)
+{
+  Errors e = {0, 0, 0, true};
+
+  for (const Pair &p : pairs)
+  {
+    double lat1 = p.a.lat / 1e7, lng1 = p.a.lng / 1e7;
+    double lat2 = p.b.lat / 1e7, lng2 = p.b.lng / 1e7;
+
+    double distance = TinyGPSPlus::distanceBetween(lat1, lng1, lat2, lng2);
+    double error = fabs(TinyGPSPlus::distanceBetweenE7(p.a.lat, p.a.lng, p.b.lat, p.b.lng) - distance);
+    if (error > e.distance)
+    {
+      e.distance = error;
+    }
+    if (distance > 1 && error / distance > e.relative)
+    {
+      e.relative = error / distance;
+    }
+    if (error > MAX_DISTANCE_ERROR)
+    {
+      e.ok = false;
+    }
+
+    // An error in the course moves the destination sideways; that is
+    // what counts, as the course itself is ill-conditioned between close
+    // points, at the poles and between antipodes
+    if (distance > 0)
+    {
+      double course = TinyGPSPlus::courseTo(lat1, lng1, lat2, lng2);
+      double diff = fabs(TinyGPSPlus::courseToE7(p.a.lat, p.a.lng, p.b.lat, p.b.lng) / 1e7 - course);
+      if (diff > 180)
+      {
+        diff = 360 - diff;
+      }
+      double sideways = radians(diff) * _GPS_EARTH_MEAN_RADIUS * sin(distance / _GPS_EARTH_MEAN_RADIUS);
+      if (sideways > e.course)
+      {
+        e.course = sideways;
+      }
+      if (sideways > MAX_COURSE_ERROR)
+      {
+        e.ok = false;
+      }
+    }
+  }
+  return e;
+}
+
+
+/**
+ * latE7() and lngE7() are lat() and lng() rounded to 1e-7 degrees
+ */
+bool check_location(uint32_t &state)
+{
+  TinyGPSPlus gps;
+  char body[96];
+  char sentence[128];
+
+  for (int i = 0; i < SENTENCES; i++)
+  {
+    unsigned lat = next_random(state) % 9000, lng = next_random(state) % 18000;
+    snprintf(body, sizeof(body), "GPGGA,120000.00,%02u%02u.%07u,%c,%03u%02u.%07u,%c,1,08,1.0,10.0,M,0.0,M,,",
+             lat / 100, lat % 100 * 60 / 100, next_random(state) % 10000000, i % 2 ? 'N' : 'S',
+             lng / 100, lng % 100 * 60 / 100, next_random(state) % 10000000, i % 3 ? 'E' : 'W');
+    uint8_t parity = 0;
+    for (const char *c = body; *c; c++)
+    {
+      parity ^= (uint8_t)*c;
+    }
+    snprintf(sentence, sizeof(sentence), "$%s*%02X\r\n", body, parity);
+    gps.encode(sentence, strlen(sentence));
+
+    // Half-way cases may go either way in double
+    if (fabs(gps.location.latE7() - gps.location.lat() * 1e7) > 0.5 + 1e-6
+        || fabs(gps.location.lngE7() - gps.location.lng() * 1e7) > 0.5 + 1e-6)
+    {
+      printf("%s", sentence);
+      return false;
+    }
+  }
+  return gps.passedChecksum() == (uint32_t)SENTENCES;
+}
+
+
+/**
+ * Time per distance and course call
+ */
+void time_calls(const char *name, const std::vector<Pair> &pairs)
+{
+  typedef std::chrono::steady_clock Clock;
+  volatile double sink_double = 0;
+  volatile uint32_t sink_integer = 0;
+  double seconds[2];
+
+  for (int integer = 0; integer < 2; integer++)
+  {
+    Clock::time_point start = Clock::now();
+    uint64_t calls = 0;
+    do
+    {
+      for (const Pair &p : pairs)
+      {
+        if (integer)
+        {
+          sink_integer += TinyGPSPlus::distanceBetweenE7(p.a.lat, p.a.lng, p.b.lat, p.b.lng);
+          sink_integer += TinyGPSPlus::courseToE7(p.a.lat, p.a.lng, p.b.lat, p.b.lng);
+        }
+        else
+        {
+          double lat1 = p.a.lat / 1e7, lng1 = p.a.lng / 1e7;
+          double lat2 = p.b.lat / 1e7, lng2 = p.b.lng / 1e7;
+          sink_double += TinyGPSPlus::distanceBetween(lat1, lng1, lat2, lng2);
+          sink_double += TinyGPSPlus::courseTo(lat1, lng1, lat2, lng2);
+        }
+      }
+      calls += 2 * pairs.size();
+      seconds[integer] = std::chrono::duration<double>(Clock::now() - start).count();
+    } while (seconds[integer] < MIN_RUN_SECONDS);
+    seconds[integer] /= calls;
+  }
+
+  printf("%-20s %14.1f %14.1f %13.2fx\n", name,
+         1e9 * seconds[0], 1e9 * seconds[1], seconds[1] / seconds[0]);
+}
+
@@ -0,0 +1,626 @@
+/**
+ *
+ * Host-side NMEA parsing throughput benchmark for TinyGPSPlus
+ * Started: 16.10.2026
+ * Tauno Erik
+ *
+ * Replays synthetic NMEA corpora (one per sentence type, a NEO-6M like
+ * mix, corrupt checksums and truncated sentences) and any recorded
+ * captures given on the command line (e.g. the output of the RAW command)
+ * through TinyGPSPlus::encode() and reports bytes/s, sentences/s and
+ * cycles/sentence. A second table compares the CPU time per fix of the
+ * NMEA sentences with the UBX NAV-PVT and NAV-TIMEUTC messages, all fed
+ * through TinyGPSUbx like on the clock.
+ *
+ * Build (from the repository root):
+ *   g++ -O2 -std=c++11 -Ilib/TinyGPSPlus-master/src \
+ *       tools/nmea_bench/nmea_bench.cpp \
+ *       lib/TinyGPSPlus-master/src/TinyGPS++.cpp \
+ *       lib/TinyGPSPlus-master/src/TinyGPSUbx.cpp -o nmea_bench
+ *
+ * Usage:
+ *   ./nmea_bench [capture.nmea ...]
+ *
+ */
+#include <TinyGPS++.h>
+#include <TinyGPSUbx.h>
+
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HAVE_CYCLE_COUNTER 1
+#endif
+
+// Minimum wall time spent on each corpus
+static const double MIN_RUN_SECONDS = 0.25;
+
+// Number of sentences in each synthetic corpus
+static const int CORPUS_SENTENCES = 20000;
+
+// Number of fixes in each NMEA vs UBX corpus
+static const int CORPUS_FIXES = 10000;
+
+struct Corpus {
+  std::string name;
+  std::string data;
+  uint32_t sentences; // '$' count, i.e. sentences offered to the parser
+};
+
+struct Result {
+  double seconds;
+  uint64_t cycles;
+  uint64_t bytes;
+  uint64_t sentences;
+  uint64_t passed;
+  uint64_t failed;
+};
+
+/**********************************************
+ * Function prototypes
+ **********************************************/
+uint32_t next_random();
+std::string nmea_sentence(const char *body);
+std::string make_rmc(uint32_t t);
+std::string make_gga(uint32_t t);
+std::string make_gsv(uint32_t t, int part, int parts);
+std::string make_gsa(uint32_t t);
+std::string make_vtg(uint32_t t);
+std::string make_gll(uint32_t t);
+std::string make_zda(uint32_t t);
+std::string ubx_frame(uint8_t msg_class, uint8_t msg_id, const void *payload, uint16_t len);
+std::string make_nav_pvt(uint32_t t);
+std::string make_nav_timeutc(uint32_t t);
+Corpus make_fix_corpus(const char *name, std::string (*make)(uint32_t));
+Result run_fix_corpus(const Corpus &corpus);
+void print_fix_result(const Corpus &corpus, const Result &r);
+Corpus make_corpus(const char *name, std::string (*make)(uint32_t));
+Corpus make_mixed_corpus();
+Corpus make_corrupt_corpus();
+Corpus make_truncated_corpus();
+bool load_corpus(const char *path, Corpus &corpus);
+Result run_corpus(const Corpus &corpus, bool bulk);
+void print_result(const Corpus &corpus, const char *mode, const Result &r);
+
+/*********************************************/
+int main(int argc, char *argv[])
+{
+  std::vector<Corpus> corpora;
+
+  corpora.push_back(make_corpus("RMC", make_rmc));
+  corpora.push_back(make_corpus("GGA", make_gga));
+  corpora.push_back(make_corpus("GSV", [](uint32_t t) { return make_gsv(t, 1 + t % 3, 3); }));
+  corpora.push_back(make_corpus("GSA", make_gsa));
+  corpora.push_back(make_corpus("VTG", make_vtg));
+  corpora.push_back(make_corpus("GLL", make_gll));
+  corpora.push_back(make_corpus("ZDA", make_zda));
+  corpora.push_back(make_mixed_corpus());
+  corpora.push_back(make_corrupt_corpus());
+  corpora.push_back(make_truncated_corpus());
+
+  for (int i = 1; i < argc; i++)
+  {
+    Corpus corpus;
+    if (!load_corpus(argv[i], corpus))
+    {
+      fprintf(stderr, "Can't read %s\n", argv[i]);
+      return 1;
+    }
+    corpora.push_back(corpus);
+  }
+
+  printf("TinyGPSPlus %s NMEA parsing benchmark\n\n", TinyGPSPlus::libraryVersion());
+  printf("%-16s %-5s %9s %12s %12s %10s %8s %8s\n",
+         "corpus", "mode", "bytes", "MB/s", "sentences/s",
+#if HAVE_CYCLE_COUNTER
+         "cyc/sent",
+#else
+         "ns/sent",
+#endif
+         "passed", "failed");
+
+  for (const Corpus &corpus : corpora)
+  {
+    print_result(corpus, "byte", run_corpus(corpus, false));
+    print_result(corpus, "bulk", run_corpus(corpus, true));
+  }
+
+  std::vector<Corpus> fixes;
+  fixes.push_back(make_fix_corpus("NMEA RMC+GGA", [](uint32_t t) { return make_rmc(t) + make_gga(t); }));
+  fixes.push_back(make_fix_corpus("UBX NAV-PVT", make_nav_pvt));
+  fixes.push_back(make_fix_corpus("NMEA RMC", make_rmc));
+  fixes.push_back(make_fix_corpus("UBX NAV-TIMEUTC", make_nav_timeutc));
+
+  printf("\nCPU per fix, through TinyGPSUbx::encode(buf, len)\n\n");
+  printf("%-16s %9s %12s %10s %8s\n", "corpus", "bytes/fix", "fixes/s",
+#if HAVE_CYCLE_COUNTER
+         "cyc/fix",
+#else
+         "ns/fix",
+#endif
+         "msg/fix");
+
+  for (const Corpus &corpus : fixes)
+  {
+    print_fix_result(corpus, run_fix_corpus(corpus));
+  }
+
+  return 0;
+}
+
+
+/**
+ * Small deterministic PRNG so every run replays the same corpus
+ */
+uint32_t next_random()
+{
+  static uint32_t state = 2463534242UL;
+  state ^= state << 13;
+  state ^= state >> 17;
+  state ^= state << 5;
+  return state;
+}
+
+
+/**
+ * Wrap a sentence body ("GPRMC,...") with '$', checksum and CR/LF
+ * @param body: sentence without '$' and '*'
+ * @return the complete sentence
+ */
+std::string nmea_sentence(const char *body)
+{
+  uint8_t parity = 0;
+  for (const char *p = body; *p; p++)
+  {
+    parity ^= (uint8_t)*p;
+  }
+
+  char tail[8];
+  snprintf(tail, sizeof(tail), "*%02X\r\n", parity);
+
+  return std::string("$") + body + tail;
+}
+
+
+/**
+ * Sentence generators. @param t: fix number, one per second
+ */
+std::string make_rmc(uint32_t t)
+{
+  char body[96];
+  snprintf(body, sizeof(body),
+           "GPRMC,%02u%02u%02u.00,A,5922.%05u,N,02445.%05u,E,%u.%03u,%u.%02u,%02u0325,,,A",
+           (t / 3600) % 24, (t / 60) % 60, t % 60,
+           next_random() % 100000, next_random() % 100000,
+           next_random() % 3, next_random() % 1000,
+           next_random() % 360, next_random() % 100, 1 + (t / 86400) % 28);
+  return nmea_sentence(body);
+}
+
+std::string make_gga(uint32_t t)
+{
+  char body[96];
+  snprintf(body, sizeof(body),
+           "GPGGA,%02u%02u%02u.00,5922.%05u,N,02445.%05u,E,1,%02u,%u.%02u,%u.%u,M,18.9,M,,",
+           (t / 3600) % 24, (t / 60) % 60, t % 60,
+           next_random() % 100000, next_random() % 100000,
+           4 + next_random() % 8, 1 + next_random() % 3, next_random() % 100,
+           30 + next_random() % 20, next_random() % 10);
+  return nmea_sentence(body);
+}
+
+std::string make_gsv(uint32_t t, int part, int parts)
+{
+  (void)t;
+  char body[96];
+  int len = snprintf(body, sizeof(body), "GPGSV,%d,%d,%02d", parts, part, parts * 4 - 1);
+  int sats = part == parts ? 3 : 4;
+
+  for (int i = 0; i < sats; i++)
+  {
+    unsigned snr = next_random() % 50;
+    if (snr < 10)
+    {
+      len += snprintf(body + len, sizeof(body) - len, ",%02u,%02u,%03u,",
+                      1 + next_random() % 32, next_random() % 90, next_random() % 360);
+    }
+    else
+    {
+      len += snprintf(body + len, sizeof(body) - len, ",%02u,%02u,%03u,%02u",
+                      1 + next_random() % 32, next_random() % 90, next_random() % 360, snr);
+    }
+  }
+  return nmea_sentence(body);
+}
+
+std::string make_gsa(uint32_t t)
+{
+  (void)t;
+  char body[96];
+  snprintf(body, sizeof(body),
+           "GPGSA,A,3,%02u,%02u,%02u,%02u,%02u,%02u,,,,,,,%u.%02u,%u.%02u,%u.%02u",
+           1 + next_random() % 32, 1 + next_random() % 32, 1 + next_random() % 32,
+           1 + next_random() % 32, 1 + next_random() % 32, 1 + next_random() % 32,
+           1 + next_random() % 3, next_random() % 100,
+           1 + next_random() % 3, next_random() % 100,
+           1 + next_random() % 3, next_random() % 100);
+  return nmea_sentence(body);
+}
+
+std::string make_vtg(uint32_t t)
+{
+  (void)t;
+  char body[96];
+  snprintf(body, sizeof(body), "GPVTG,,T,,M,%u.%03u,N,%u.%03u,K,A",
+           next_random() % 3, next_random() % 1000, next_random() % 5, next_random() % 1000);
+  return nmea_sentence(body);
+}
+
+std::string make_gll(uint32_t t)
+{
+  char body[96];
+  snprintf(body, sizeof(body), "GPGLL,5922.%05u,N,02445.%05u,E,%02u%02u%02u.00,A,A",
+           next_random() % 100000, next_random() % 100000,
+           (t / 3600) % 24, (t / 60) % 60, t % 60);
+  return nmea_sentence(body);
+}
+
+std::string make_zda(uint32_t t)
+{
+  char body[96];
+  snprintf(body, sizeof(body), "GPZDA,%02u%02u%02u.00,%02u,03,2025,00,00",
+           (t / 3600) % 24, (t / 60) % 60, t % 60, 1 + (t / 86400) % 28);
+  return nmea_sentence(body);
+}
+
+
+/**
+ * Wrap a payload into a UBX frame
+ */
+std::string ubx_frame(uint8_t msg_class, uint8_t msg_id, const void *payload, uint16_t len)
+{
+  uint8_t frame[_GPS_UBX_MAX_PAYLOAD + _GPS_UBX_FRAME_OVERHEAD];
+  size_t size = TinyGPSUbx::buildFrame(msg_class, msg_id, (const uint8_t *)payload, len, frame);
+  return std::string((const char *)frame, size);
+}
+
+
+/**
+ * UBX message generators, the same content as RMC + GGA
+ * @param t: fix number, one per second
+ */
+std::string make_nav_pvt(uint32_t t)
+{
+  TinyGPSUbxNavPvt pvt = {};
+  pvt.iTOW = t * 1000;
+  pvt.year = 2025;
+  pvt.month = 3;
+  pvt.day = 1 + (t / 86400) % 28;
+  pvt.hour = (t / 3600) % 24;
+  pvt.min = (t / 60) % 60;
+  pvt.sec = t % 60;
+  pvt.valid = UBX_PVT_VALID_DATE | UBX_PVT_VALID_TIME;
+  pvt.fixType = 3;
+  pvt.flags = UBX_PVT_FLAGS_FIX_OK;
+  pvt.numSV = 4 + next_random() % 8;
+  pvt.lat = 593700000 + next_random() % 16667;
+  pvt.lon = 247500000 + next_random() % 16667;
+  pvt.hMSL = 30000 + next_random() % 20000;
+  pvt.gSpeed = next_random() % 1500;
+  pvt.headMot = next_random() % 36000000;
+  pvt.pDOP = 100 + next_random() % 300;
+  return ubx_frame(UBX_CLASS_NAV, UBX_NAV_PVT, &pvt, sizeof(pvt));
+}
+
+std::string make_nav_timeutc(uint32_t t)
+{
+  TinyGPSUbxNavTimeUtc utc = {};
+  utc.iTOW = t * 1000;
+  utc.year = 2025;
+  utc.month = 3;
+  utc.day = 1 + (t / 86400) % 28;
+  utc.hour = (t / 3600) % 24;
+  utc.min = (t / 60) % 60;
+  utc.sec = t % 60;
+  utc.valid = UBX_TIMEUTC_VALID_UTC;
+  return ubx_frame(UBX_CLASS_NAV, UBX_NAV_TIMEUTC, &utc, sizeof(utc));
+}
+
+
+/**
+ * Corpus with the messages of CORPUS_FIXES fixes
+ */
+Corpus make_fix_corpus(const char *name, std::string (*make)(uint32_t))
+{
+  Corpus corpus;
+  corpus.name = name;
+  corpus.sentences = CORPUS_FIXES;
+
+  for (int i = 0; i < CORPUS_FIXES; i++)
+  {
+    corpus.data += make(i);
+  }
+  return corpus;
+}
+
+
+/**
+ * Corpus with a single sentence type
+ */
+Corpus make_corpus(const char *name, std::string (*make)(uint32_t))
+{
+  Corpus corpus;
+  corpus.name = name;
+  corpus.sentences = CORPUS_SENTENCES;
+
+  for (int i = 0; i < CORPUS_SENTENCES; i++)
+  {
+    corpus.data += make(i);
+  }
+  return corpus;
+}
+
+
+/**
+ * Corpus with the factory default NEO-6M output:
+ * RMC, VTG, GGA, GSA, 3 x GSV and GLL once per second
+ */
+Corpus make_mixed_corpus()
+{
+  Corpus corpus;
+  corpus.name = "mix NEO-6M";
+  corpus.sentences = 0;
+
+  for (uint32_t t = 0; corpus.sentences < (uint32_t)CORPUS_SENTENCES; t++)
+  {
+    corpus.data += make_rmc(t);
+    corpus.data += make_vtg(t);
+    corpus.data += make_gga(t);
+    corpus.data += make_gsa(t);
+    corpus.data += make_gsv(t, 1, 3);
+    corpus.data += make_gsv(t, 2, 3);
+    corpus.data += make_gsv(t, 3, 3);
+    corpus.data += make_gll(t);
+    corpus.sentences += 8;
+  }
+  return corpus;
+}
+
+
+/**
+ * Mixed RMC/GGA corpus where every fourth sentence has a broken checksum
+ */
+Corpus make_corrupt_corpus()
+{
+  Corpus corpus;
+  corpus.name = "corrupt 25%";
+  corpus.sentences = CORPUS_SENTENCES;
+
+  for (int i = 0; i < CORPUS_SENTENCES; i++)
+  {
+    std::string s = (i & 1) ? make_gga(i / 2) : make_rmc(i / 2);
+    if (i % 4 == 3)
+    {
+      // Flip a bit in the middle of the sentence
+      s[s.size() / 2] ^= 0x01;
+    }
+    corpus.data += s;
+  }
+  return corpus;
+}
+
+
+/**
+ * Mixed RMC/GGA corpus where every fourth line is cut short before the
+ * end of its checksum, as when the UART drops the rest of a line
+ */
+Corpus make_truncated_corpus()
+{
+  Corpus corpus;
+  corpus.name = "truncated 25%";
+  corpus.sentences = CORPUS_SENTENCES;
+
+  for (int i = 0; i < CORPUS_SENTENCES; i++)
+  {
+    std::string s = (i & 1) ? make_gga(i / 2) : make_rmc(i / 2);
+    if (i % 4 == 3)
+    {
+      s.resize(1 + next_random() % (s.find('*') + 2));
+      s += "\r\n";
+    }
+    corpus.data += s;
+  }
+  return corpus;
+}
+
+
+/**
+ * Load a recorded capture
+ * @param path: file with raw NMEA data
+ * @param corpus: corpus to fill
+ * @return true on success
+ */
+bool load_corpus(const char *path, Corpus &corpus)
+{
+  FILE *file = fopen(path, "rb");
+  if (!file)
+  {
+    return false;
+  }
+
+  char buffer[4096];
+  size_t len;
+  while ((len = fread(buffer, 1, sizeof(buffer), file)) > 0)
+  {
+    corpus.data.append(buffer, len);
+  }
+  fclose(file);
+
+  const char *name = strrchr(path, '/');
+  corpus.name = name ? name + 1 : path;
+  corpus.sentences = 0;
+  for (char c : corpus.data)
+  {
+    if (c == '$')
+    {
+      corpus.sentences++;
+    }
+  }
+
+  return corpus.sentences > 0;
+}
+
+
+/**
+ * Replay a corpus until MIN_RUN_SECONDS have passed, timing each pass
+ * @param corpus: corpus to replay
+ * @param bulk: use encode(buf, len) in 64-byte chunks like run_gps(),
+ *              otherwise encode(char) one byte at a time
+ * @return the measurement of the fastest pass
+ */
+Result run_corpus(const Corpus &corpus, bool bulk)
+{
+  static const size_t CHUNK = 64;
+
+  Result r = {0, 0, 0, 0, 0, 0};
+  const char *data = corpus.data.data();
+  size_t size = corpus.data.size();
+  double total = 0;
+
+  // The fastest pass: a shared host only adds its noise on top
+  do
+  {
+    TinyGPSPlus gps;
+    auto start = std::chrono::steady_clock::now();
+#if HAVE_CYCLE_COUNTER
+    uint64_t start_cycles = __rdtsc();
+#endif
+
+    if (bulk)
+    {
+      for (size_t i = 0; i < size; i += CHUNK)
+      {
+        gps.encode(data + i, size - i < CHUNK ? size - i : CHUNK);
+      }
+    }
+    else
+    {
+      for (size_t i = 0; i < size; i++)
+      {
+        gps.encode(data[i]);
+      }
+    }
+
+#if HAVE_CYCLE_COUNTER
+    uint64_t cycles = __rdtsc() - start_cycles;
+#endif
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (r.bytes == 0 || seconds < r.seconds)
+    {
+      r.seconds = seconds;
+#if HAVE_CYCLE_COUNTER
+      r.cycles = cycles;
+#endif
+    }
+    r.bytes = size;
+    r.sentences = corpus.sentences;
+    r.passed = gps.passedChecksum();
+    r.failed = gps.failedChecksum();
+    total += seconds;
+  } while (total < MIN_RUN_SECONDS);
+
+  return r;
+}
+
+
+/**
+ * Replay a fix corpus through TinyGPSUbx in 64-byte chunks
+ * @param corpus: corpus to replay, sentences is the number of fixes
+ * @return the measurement, passed counts the NMEA sentences and UBX frames
+ */
+Result run_fix_corpus(const Corpus &corpus)
+{
+  static const size_t CHUNK = 64;
+
+  Result r = {0, 0, 0, 0, 0, 0};
+  const char *data = corpus.data.data();
+  size_t size = corpus.data.size();
+
+  auto start = std::chrono::steady_clock::now();
+#if HAVE_CYCLE_COUNTER
+  uint64_t start_cycles = __rdtsc();
+#endif
+
+  do
+  {
+    TinyGPSPlus gps;
+    TinyGPSUbx ubx(gps);
+
+    for (size_t i = 0; i < size; i += CHUNK)
+    {
+      ubx.encode(data + i, size - i < CHUNK ? size - i : CHUNK);
+    }
+
+    if (!gps.date.isValid() || !gps.time.isValid())
+    {
+      fprintf(stderr, "%s: no date and time decoded\n", corpus.name.c_str());
+      exit(1);
+    }
+
+    r.bytes += size;
+    r.sentences += corpus.sentences;
+    r.passed += gps.passedChecksum() + ubx.framesProcessed();
+    r.failed += gps.failedChecksum() + ubx.failedChecksum();
+    r.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  } while (r.seconds < MIN_RUN_SECONDS);
+
+#if HAVE_CYCLE_COUNTER
+  r.cycles = __rdtsc() - start_cycles;
+#endif
+
+  return r;
+}
+
+
+/**
+ * Print one result line of the fix table
+ */
+void print_fix_result(const Corpus &corpus, const Result &r)
+{
+#if HAVE_CYCLE_COUNTER
+  double per_fix = (double)r.cycles / r.sentences;
+#else
+  double per_fix = r.seconds * 1e9 / r.sentences;
+#endif
+
+  printf("%-16s %9zu %12.0f %10.0f %8.1f\n",
+         corpus.name.c_str(), corpus.data.size() / corpus.sentences,
+         r.sentences / r.seconds, per_fix,
+         (double)r.passed / r.sentences);
+}
+
+
+/**
+ * Print one result line
+ */
+void print_result(const Corpus &corpus, const char *mode, const Result &r)
+{
+#if HAVE_CYCLE_COUNTER
+  double per_sentence = (double)r.cycles / r.sentences;
+#else
+  double per_sentence = r.seconds * 1e9 / r.sentences;
+#endif
+
+  printf("%-16s %-5s %9zu %12.1f %12.0f %10.0f %8.1f%% %7.1f%%\n",
+         corpus.name.c_str(), mode, corpus.data.size(),
+         r.bytes / r.seconds / 1e6,
+         r.sentences / r.seconds,
+         per_sentence,
+         100.0 * r.passed / r.sentences,
+         100.0 * r.failed / r.sentences);
+}
@@ -0,0 +1,616 @@
+/**
+ *
+ * Replays a GPS capture through the clock firmware on Linux
+ * Started: 16.10.2026
+ * Tauno Erik
+ *
+ * The firmware (src/main.cpp and its modules) runs on a virtual clock:
+ * this file is its HAL backend (see include/hal.h). The bytes and PPS pulses of a capture (see include/capture.h, recorded
+ * with the REC command) are delivered at their recorded times, while
+ * loop() idles in delay() as on the ESP8266, only without waiting, so a
+ * day of input replays in seconds. Every change of the digits on the
+ * display is printed with its virtual time; the output of two firmware
+ * versions can be compared with diff.
+ *
+ * -g writes a synthetic capture instead: PPS and GGA/ZDA every second,
+ * starting 2026-03-28 22:00:00 UTC (three hours before the EU summer time
+ * starts), optionally with a crystal error and a GPS outage.
+ *
+ * Build (from the repository root):
+ *   g++ -O2 -std=gnu++17 -D_GPS_FEATURES=_GPS_FEATURE_STATS \
+ *       -Iinclude -Ilib/TinyGPSPlus-master/src \
+ *       tools/replay/replay.cpp src/main.cpp src/capture.cpp src/console.cpp \
+ *       src/date_time.cpp src/disciplined_clock.cpp src/frame.cpp \
+ *       src/gps_config.cpp src/gps_uart.cpp src/pps_clock.cpp \
+ *       src/recorder.cpp src/scheduler.cpp src/settings_store.cpp \
+ *       src/stats.cpp src/time_zone.cpp \
+ *       lib/TinyGPSPlus-master/src/TinyGPS++.cpp \
+ *       lib/TinyGPSPlus-master/src/TinyGPSUbx.cpp -o replay
+ * Add e.g. -g -fsanitize=address,undefined for a sanitizer run.
+ *
+ * Usage:
+ *   ./replay [-v] [-q] [-e COMMAND]... capture.bin
+ *     -v  print the console output of the firmware
+ *     -q  only print the summary
+ *     -e  run a console command after setup(), e.g. -e "TZ CET-1CEST,M3.5.0,M10.5.0/3"
+ *   ./replay -g SECONDS [-d PPM] [-o START:LENGTH] capture.bin
+ *     -d  the local clock runs PPM fast
+ *     -o  no PPS and no sentences for LENGTH seconds from START
+ *
+ */
+#include "hal.h"
+#include "capture.h"
+#include "date_time.h"
+#include "display.h"
+#include "frame.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <deque>
+#include <string>
+#include <vector>
+
+// Time the firmware gets from setup() to the first recorded byte
+static const uint64_t REPLAY_START_US = 100000;
+
+// Run time of one pass of loop(), on the virtual clock
+static const uint64_t LOOP_COST_US = 50;
+
+// Keep running after the last record, to see the clock coast
+static const uint64_t REPLAY_TAIL_US = 2000000;
+
+// Synthetic capture: serial line at 115200 bps, chunks of the SoftwareSerial size
+static const uint32_t GEN_BYTE_US = 87;
+static const size_t GEN_CHUNK = 32;
+static const uint32_t GEN_SENTENCE_DELAY_US = 60000;
+static const int64_t GEN_START = 828050400; // 2026-03-28 22:00:00 UTC, seconds since 2000
+
+static const uint32_t CPU_MHZ = 80;
+
+// Virtual time in microseconds
+static uint64_t time_us = 0;
+
+// PPS pin
+static hal_callback pps_isr = 0;
+
+// Serial console
+static bool echo = false;
+static std::string console_input;
+
+// GPS module
+static std::deque<uint8_t> gps_rx;
+static size_t gps_rx_size = 64;
+static bool gps_overflowed = false;
+static hal_callback gps_on_receive = 0;
+static bool gps_receive_pending = false;
+static uint32_t gps_sent = 0;
+
+// Store, in RAM
+static uint8_t sector[HAL_STORE_SIZE];
+static bool sector_ready = false;
+
+// The firmware
+void setup();
+void loop();
+
+// The capture
+static std::vector<uint8_t> capture;
+static size_t position = CAPTURE_HEADER_SIZE;
+static uint64_t next_time_us = REPLAY_START_US;
+static CaptureRecord next_record;
+static bool has_next = false;
+static uint32_t replayed_records = 0;
+static uint32_t replayed_pulses = 0;
+
+// The display
+static bool quiet = false;
+static char shown[6] = "";
+static int shown_minutes = -1;
+static uint32_t display_writes = 0;
+static uint32_t minute_steps = 0;
+static uint32_t jumps = 0;
+
+
+/**
+ * Read the next record of the capture
+ */
+static void next()
+{
+  size_t used = capture_parse(capture.data() + position, capture.size() - position, next_record);
+
+  has_next = used > 0;
+  if (has_next)
+  {
+    position += used;
+    next_time_us += next_record.delta_us;
+  }
+  else if (position != capture.size())
+  {
+    fprintf(stderr, "Invalid record at byte %zu\n", position);
+  }
+}
+
+
+/**
+ * Bytes arriving from the GPS module
+ */
+static void gps_receive(const uint8_t *data, size_t len)
+{
+  for (size_t i = 0; i < len; i++)
+  {
+    if (gps_rx.size() < gps_rx_size)
+    {
+      gps_rx.push_back(data[i]);
+    }
+    else
+    {
+      gps_overflowed = true;
+    }
+  }
+
+  // EspSoftwareSerial only schedules the handler; it runs once loop()
+  // has returned
+  gps_receive_pending = true;
+}
+
+
+/**
+ * Advance the virtual clock, delivering the records due on the way
+ */
+static void run_until(uint64_t end_us)
+{
+  while (has_next && next_time_us <= end_us)
+  {
+    time_us = next_time_us;
+    if (next_record.kind == CAPTURE_PPS)
+    {
+      replayed_pulses++;
+      if (pps_isr != 0)
+      {
+        pps_isr();
+      }
+    }
+    else
+    {
+      gps_receive(next_record.data, next_record.len);
+    }
+    replayed_records++;
+    next();
+  }
+
+  if (end_us > time_us)
+  {
+    time_us = end_us;
+  }
+}
+
+
+/**********************************************
+ * HAL on the virtual clock
+ **********************************************/
+uint32_t hal_millis()
+{
+  return (uint32_t)(time_us / 1000);
+}
+
+uint32_t hal_micros()
+{
+  return (uint32_t)time_us;
+}
+
+uint64_t hal_micros64()
+{
+  return time_us;
+}
+
+void hal_delay(uint32_t ms)
+{
+  run_until(time_us + ms * 1000ULL);
+}
+
+uint32_t hal_cycle_count()
+{
+  return (uint32_t)(time_us * CPU_MHZ);
+}
+
+uint32_t hal_cpu_mhz()
+{
+  return CPU_MHZ;
+}
+
+void hal_pps_begin(uint8_t pin, hal_callback isr)
+{
+  pps_isr = isr;
+}
+
+void hal_disable_interrupts()
+{
+}
+
+void hal_enable_interrupts()
+{
+}
+
+void hal_radio_off()
+{
+}
+
+void hal_console_begin(uint32_t baud)
+{
+}
+
+size_t hal_console_available()
+{
+  return console_input.size();
+}
+
+int hal_console_read()
+{
+  if (console_input.empty())
+  {
+    return -1;
+  }
+  int c = (uint8_t)console_input[0];
+  console_input.erase(0, 1);
+  return c;
+}
+
+size_t hal_console_write(const uint8_t *data, size_t len)
+{
+  if (echo)
+  {
+    fwrite(data, 1, len, stdout);
+  }
+  return len;
+}
+
+void hal_gps_begin(uint8_t rx_pin, uint8_t tx_pin, uint32_t baud, size_t buffer_size, hal_callback on_receive)
+{
+  gps_rx_size = buffer_size;
+  gps_on_receive = on_receive;
+}
+
+void hal_gps_end()
+{
+  gps_rx.clear();
+}
+
+size_t hal_gps_available()
+{
+  return gps_rx.size();
+}
+
+size_t hal_gps_read(uint8_t *buffer, size_t len)
+{
+  size_t n = 0;
+  for (; n < len && !gps_rx.empty(); n++)
+  {
+    buffer[n] = gps_rx.front();
+    gps_rx.pop_front();
+  }
+  return n;
+}
+
+size_t hal_gps_write(const uint8_t *data, size_t len)
+{
+  gps_sent += len;
+  return len;
+}
+
+bool hal_gps_overflow()
+{
+  bool overflowed = gps_overflowed;
+  gps_overflowed = false;
+  return overflowed;
+}
+
+bool hal_store_erase()
+{
+  memset(sector, 0xFF, sizeof(sector));
+  sector_ready = true;
+  return true;
+}
+
+bool hal_store_read(uint16_t offset, uint32_t *data, uint16_t len)
+{
+  if (!sector_ready)
+  {
+    hal_store_erase();
+  }
+  memcpy(data, sector + offset, len);
+  return true;
+}
+
+bool hal_store_write(uint16_t offset, const uint32_t *data, uint16_t len)
+{
+  if (!sector_ready)
+  {
+    hal_store_erase();
+  }
+
+  // Programming can only clear bits
+  const uint8_t *bytes = (const uint8_t *)data;
+  for (uint16_t i = 0; i < len; i++)
+  {
+    sector[offset + i] &= bytes[i];
+  }
+  return true;
+}
+
+
+/**
+ * The 74HC595 chain: decode the digits and print them when they change
+ */
+void display_begin(uint8_t data_pin, uint8_t latch_pin, uint8_t clock_pin)
+{
+}
+
+
+void display_write(uint32_t frame)
+{
+  char text[6];
+
+  display_writes++;
+
+  // The dot is ignored
+  frame_text(frame, text);
+  text[2] = ':';
+
+  if (strcmp(text, shown) == 0)
+  {
+    return;
+  }
+  strcpy(shown, text);
+
+  int hour, minute;
+  int minutes = -1;
+  if (sscanf(text, "%2d:%2d", &hour, &minute) == 2 && strchr(text, '?') == 0)
+  {
+    minutes = hour * 60 + minute;
+  }
+
+  // Anything but the next minute is a jump (summer time, resync, ...)
+  bool jump = false;
+  if (minutes >= 0 && shown_minutes >= 0)
+  {
+    if (minutes == (shown_minutes + 1) % 1440)
+    {
+      minute_steps++;
+    }
+    else
+    {
+      jump = true;
+      jumps++;
+    }
+  }
+  if (minutes >= 0)
+  {
+    shown_minutes = minutes;
+  }
+
+  if (!quiet && strchr(text, '?') == 0)
+  {
+    printf("%12.6f %s%s\n", (time_us - (int64_t)REPLAY_START_US) / 1e6, text, jump ? " jump" : "");
+  }
+}
+
+
+static bool read_file(const char *path, std::vector<uint8_t> &data)
+{
+  FILE *in = fopen(path, "rb");
+  if (in == 0)
+  {
+    return false;
+  }
+
+  uint8_t chunk[4096];
+  size_t len;
+  while ((len = fread(chunk, 1, sizeof(chunk), in)) > 0)
+  {
+    data.insert(data.end(), chunk, chunk + len);
+  }
+  fclose(in);
+  return true;
+}
+
+
+/**
+ * Append a record at the local time
+ */
+static void add_record(std::vector<uint8_t> &out, uint64_t &prev_us, uint64_t time_us, uint8_t kind, const uint8_t *data, uint16_t len)
+{
+  uint8_t record[CAPTURE_MAX_DATA + CAPTURE_MAX_OVERHEAD];
+  size_t n = capture_record(record, (uint32_t)(time_us - prev_us), kind, data, len);
+  out.insert(out.end(), record, record + n);
+  prev_us = time_us;
+}
+
+
+static void add_sentence(std::string &text, const char *body)
+{
+  uint8_t checksum = 0;
+  for (const char *p = body; *p != '\0'; p++)
+  {
+    checksum ^= *p;
+  }
+
+  char end[8];
+  snprintf(end, sizeof(end), "*%02X\r\n", checksum);
+  text += '$';
+  text += body;
+  text += end;
+}
+
+
+/**
+ * Write a synthetic capture
+ * @param seconds: length
+ * @param ppm: crystal error of the local clock
+ * @param outage_start, outage_length: seconds without PPS and sentences
+ */
+static bool generate(const char *path, uint32_t seconds, double ppm, uint32_t outage_start, uint32_t outage_length)
+{
+  std::vector<uint8_t> out(CAPTURE_HEADER_SIZE);
+  capture_header(out.data());
+
+  uint64_t prev_us = 0;
+  double rate = 1 + ppm / 1e6;
+
+  for (uint32_t s = 0; s < seconds; s++)
+  {
+    if (s >= outage_start && s < outage_start + outage_length)
+    {
+      continue;
+    }
+
+    // PPS at the start of the second, the sentences after it
+    uint64_t second_us = (uint64_t)((s + 1) * 1e6 * rate);
+    add_record(out, prev_us, second_us, CAPTURE_PPS, 0, 0);
+
+    DateTime dt;
+    epoch_to_date_time(GEN_START + s, dt);
+
+    char body[96];
+    std::string text;
+    snprintf(body, sizeof(body), "GPGGA,%02d%02d%02d.00,5925.6000,N,02445.1000,E,1,08,1.0,40.0,M,18.0,M,,",
+             dt.hour, dt.minute, dt.second);
+    add_sentence(text, body);
+    snprintf(body, sizeof(body), "GPZDA,%02d%02d%02d.00,%02d,%02d,%04d,00,00",
+             dt.hour, dt.minute, dt.second, dt.day, dt.month, dt.year);
+    add_sentence(text, body);
+
+    // Each chunk arrives when its last byte has been received
+    uint64_t time_us = second_us + (uint64_t)(GEN_SENTENCE_DELAY_US * rate);
+    for (size_t i = 0; i < text.size(); i += GEN_CHUNK)
+    {
+      size_t len = text.size() - i < GEN_CHUNK ? text.size() - i : GEN_CHUNK;
+      time_us += (uint64_t)(len * GEN_BYTE_US * rate);
+      add_record(out, prev_us, time_us, CAPTURE_DATA, (const uint8_t *)text.data() + i, len);
+    }
+  }
+
+  FILE *file = fopen(path, "wb");
+  if (file == 0 || fwrite(out.data(), 1, out.size(), file) != out.size())
+  {
+    return false;
+  }
+  fclose(file);
+  fprintf(stderr, "%s: %u seconds, %zu bytes\n", path, seconds, out.size());
+  return true;
+}
+
+
+static int usage()
+{
+  fprintf(stderr, "Usage: replay [-v] [-q] [-e COMMAND]... capture.bin\n"
+                  "       replay -g SECONDS [-d PPM] [-o START:LENGTH] capture.bin\n");
+  return 2;
+}
+
+
+int main(int argc, char *argv[])
+{
+  std::vector<const char *> commands;
+  const char *path = 0;
+  long generate_seconds = -1;
+  double ppm = 0;
+  unsigned outage_start = 0, outage_length = 0;
+
+  for (int i = 1; i < argc; i++)
+  {
+    if (strcmp(argv[i], "-v") == 0)
+    {
+      echo = true;
+    }
+    else if (strcmp(argv[i], "-q") == 0)
+    {
+      quiet = true;
+    }
+    else if (strcmp(argv[i], "-e") == 0 && i + 1 < argc)
+    {
+      commands.push_back(argv[++i]);
+    }
+    else if (strcmp(argv[i], "-g") == 0 && i + 1 < argc)
+    {
+      generate_seconds = atol(argv[++i]);
+    }
+    else if (strcmp(argv[i], "-d") == 0 && i + 1 < argc)
+    {
+      ppm = atof(argv[++i]);
+    }
+    else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc)
+    {
+      if (sscanf(argv[++i], "%u:%u", &outage_start, &outage_length) != 2)
+      {
+        return usage();
+      }
+    }
+    else if (argv[i][0] != '-' && path == 0)
+    {
+      path = argv[i];
+    }
+    else
+    {
+      return usage();
+    }
+  }
+
+  if (path == 0)
+  {
+    return usage();
+  }
+
+  if (generate_seconds >= 0)
+  {
+    if (!generate(path, generate_seconds, ppm, outage_start, outage_length))
+    {
+      fprintf(stderr, "Can't write %s\n", path);
+      return 1;
+    }
+    return 0;
+  }
+
+  if (!read_file(path, capture) || !capture_check_header(capture.data(), capture.size()))
+  {
+    fprintf(stderr, "%s is not a capture\n", path);
+    return 1;
+  }
+
+  auto wall_start = std::chrono::steady_clock::now();
+
+  setup();
+  for (const char *command : commands)
+  {
+    console_input += command;
+    console_input += '\n';
+  }
+
+  next();
+  uint64_t end_us = 0;
+  uint32_t loops = 0;
+  while (has_next || time_us < end_us)
+  {
+    loop();
+    loops++;
+    if (gps_receive_pending && gps_on_receive != 0)
+    {
+      gps_receive_pending = false;
+      gps_on_receive();
+    }
+    run_until(time_us + LOOP_COST_US);
+    if (has_next)
+    {
+      end_us = next_time_us + REPLAY_TAIL_US;
+    }
+  }
+
+  double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - wall_start).count();
+  double virtual_seconds = time_us / 1e6;
+  fprintf(stderr, "%u records (%u PPS), %.0f s virtual in %.2f s, %.0fx real time\n",
+          replayed_records, replayed_pulses, virtual_seconds, wall, virtual_seconds / (wall > 0 ? wall : 1e-9));
+  fprintf(stderr, "%u loops, %u display writes, %u minute steps, %u jumps, %u bytes sent to the GPS\n",
+          loops, display_writes, minute_steps, jumps, gps_sent);
+  return 0;
+}
@@ -0,0 +1,566 @@
+/**
+ *
+ * Simulated u-blox NEO-6M for testing the receiver configuration on Linux
+ * Started: 16.10.2026
+ * Tauno Erik
+ *
+ * The firmware's gps_config module talks to a simulated receiver over a
+ * simulated serial line, on a virtual millisecond clock. The receiver
+ * answers CFG-MSG, CFG-RATE and CFG-PRT with ACK-ACK/ACK-NAK, outputs
+ * the enabled NMEA sentences and NAV-TIMEUTC every second, and only hears the
+ * host when both ends run at the same baud rate. Each scenario prints a
+ * transcript and the serial traffic before and after the configuration.
+ *
+ * Build (from the repository root):
+ *   g++ -O2 -std=c++11 -Iinclude -Ilib/TinyGPSPlus-master/src \
+ *       tools/ubx_sim/ubx_sim.cpp src/gps_config.cpp \
+ *       lib/TinyGPSPlus-master/src/TinyGPS++.cpp \
+ *       lib/TinyGPSPlus-master/src/TinyGPSUbx.cpp -o ubx_sim
+ *
+ * Usage:
+ *   ./ubx_sim [-q]
+ *   Exit status is 0 when every scenario ends as expected.
+ *
+ */
+#include <TinyGPS++.h>
+#include <TinyGPSUbx.h>
+#include "gps_config.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <string>
+
+// How often the host polls the configuration, as in main.cpp
+static const uint32_t POLL_TIME_MS = 20;
+
+// Traffic is measured over this long before and after the configuration
+static const uint32_t MEASURE_MS = 3000;
+
+// Give up on a scenario after this long
+static const uint32_t SCENARIO_TIMEOUT_MS = 20000;
+
+// A late acknowledgement comes after the host has given up waiting
+static const uint32_t LATE_ACK_MS = 1500;
+
+struct Scenario {
+  const char *name;
+  uint32_t module_baud;   // baud rate the module starts at
+  bool speaks_ubx;        // false: an NMEA-only module that ignores UBX
+  uint8_t nak_class;      // CFG-MSG target the module rejects
+  uint8_t nak_id;
+  uint32_t drop_frames;   // lose these commands, bit n is the nth frame received
+  uint32_t late_frames;   // answer these LATE_ACK_MS late
+
+  // Expected outcome
+  uint8_t state;
+  uint8_t acked;
+  uint8_t nakked;
+  uint32_t baud;
+};
+
+// The simulated receiver
+struct Module {
+  uint32_t baud;
+  uint32_t pending_baud;  // applied once the output has been sent
+  bool speaks_ubx;
+  uint8_t nak_class;
+  uint8_t nak_id;
+  uint32_t drop_frames;
+  uint32_t late_frames;
+  uint32_t frames;        // received so far
+  bool late;              // the acknowledgement being sent is late
+  uint8_t nmea_rate[16];  // CFG-MSG rates of the NMEA sentences, by id
+  uint8_t time_utc_rate;
+  uint16_t meas_rate;
+  std::string out;        // bytes waiting to be sent to the host
+  std::string late_out;   // late acknowledgements
+  uint32_t late_at;
+  double credit;          // bytes the line can carry this millisecond
+
+  // UBX input parser
+  std::string frame;
+};
+
+static Module module;
+static uint32_t host_baud;
+static uint32_t now_ms;
+static bool quiet = false;
+
+// Traffic counters
+static uint32_t module_bytes = 0;  // sent by the module
+static uint32_t host_bytes = 0;    // sent by the host
+static uint32_t lost_bytes = 0;    // sent at mismatched baud rates
+
+/**********************************************
+ * Function prototypes
+ **********************************************/
+size_t host_write(const uint8_t *data, size_t len);
+void host_set_baud(uint32_t baud);
+void module_reset(const Scenario &s);
+void module_receive(uint8_t b);
+void module_frame(uint8_t cls, uint8_t id, const uint8_t *payload, uint16_t len);
+void module_send_ubx(uint8_t cls, uint8_t id, const uint8_t *payload, uint16_t len);
+void module_send_nmea(const char *body);
+void module_second(uint32_t second);
+void module_tick(TinyGPSUbx &ubx);
+const char *message_name(uint8_t cls, uint8_t id);
+bool run_scenario(const Scenario &s);
+
+/*********************************************/
+
+/**
+ * Host serial write: the module only hears it at the same baud rate
+ */
+size_t host_write(const uint8_t *data, size_t len)
+{
+  host_bytes += len;
+
+  if (len >= 8 && !quiet)
+  {
+    printf("  %6u ms  host -> %s (%u bytes at %u)\n", (unsigned)now_ms,
+           message_name(data[2], data[3]), (unsigned)len, (unsigned)host_baud);
+  }
+
+  if (host_baud != module.baud)
+  {
+    lost_bytes += len;
+    return len;
+  }
+
+  for (size_t i = 0; i < len; ++i)
+  {
+    module_receive(data[i]);
+  }
+
+  return len;
+}
+
+
+void host_set_baud(uint32_t baud)
+{
+  if (!quiet)
+  {
+    printf("  %6u ms  host baud %u\n", (unsigned)now_ms, (unsigned)baud);
+  }
+  host_baud = baud;
+}
+
+
+void module_reset(const Scenario &s)
+{
+  module = Module();
+  module.baud = s.module_baud;
+  module.pending_baud = 0;
+  module.speaks_ubx = s.speaks_ubx;
+  module.nak_class = s.nak_class;
+  module.nak_id = s.nak_id;
+  module.drop_frames = s.drop_frames;
+  module.late_frames = s.late_frames;
+  module.frames = 0;
+  module.late = false;
+  module.meas_rate = 1000;
+  module.credit = 0;
+
+  // NEO-6M factory default: GGA, GLL, GSA, GSV, RMC and VTG every second
+  memset(module.nmea_rate, 0, sizeof(module.nmea_rate));
+  module.nmea_rate[UBX_NMEA_GGA] = 1;
+  module.nmea_rate[UBX_NMEA_GLL] = 1;
+  module.nmea_rate[UBX_NMEA_GSA] = 1;
+  module.nmea_rate[UBX_NMEA_GSV] = 1;
+  module.nmea_rate[UBX_NMEA_RMC] = 1;
+  module.nmea_rate[UBX_NMEA_VTG] = 1;
+  module.time_utc_rate = 0;
+}
+
+
+/**
+ * Collect a UBX frame from the host
+ */
+void module_receive(uint8_t b)
+{
+  std::string &f = module.frame;
+
+  if (f.empty() && b != _GPS_UBX_SYNC_1)
+  {
+    return;
+  }
+  if (f.size() == 1 && b != _GPS_UBX_SYNC_2)
+  {
+    f.clear();
+    return;
+  }
+
+  f.push_back((char)b);
+
+  if (f.size() < 6)
+  {
+    return;
+  }
+
+  uint16_t len = (uint8_t)f[4] | ((uint8_t)f[5] << 8);
+  if (f.size() < (size_t)len + _GPS_UBX_FRAME_OVERHEAD)
+  {
+    return;
+  }
+
+  const uint8_t *data = (const uint8_t *)f.data();
+  uint8_t ck_a, ck_b;
+  TinyGPSUbx::checksum(data + 2, len + 4, ck_a, ck_b);
+
+  if (ck_a == data[len + 6] && ck_b == data[len + 7])
+  {
+    uint32_t bit = module.frames < 32 ? 1UL << module.frames : 0;
+    ++module.frames;
+    if (module.drop_frames & bit)
+    {
+      if (!quiet)
+      {
+        printf("  %6u ms  module lost %s\n", (unsigned)now_ms, message_name(data[2], data[3]));
+      }
+    }
+    else
+    {
+      module.late = (module.late_frames & bit) != 0;
+      module_frame(data[2], data[3], data + 6, len);
+      module.late = false;
+    }
+  }
+
+  f.clear();
+}
+
+
+/**
+ * Act on a command and acknowledge it
+ */
+void module_frame(uint8_t cls, uint8_t id, const uint8_t *payload, uint16_t len)
+{
+  if (!module.speaks_ubx || cls != UBX_CLASS_CFG)
+  {
+    return;
+  }
+
+  bool ok = false;
+
+  if (id == UBX_CFG_MSG && len == 3)
+  {
+    ok = !(payload[0] == module.nak_class && payload[1] == module.nak_id);
+    if (ok && payload[0] == UBX_CLASS_NMEA && payload[1] < sizeof(module.nmea_rate))
+    {
+      module.nmea_rate[payload[1]] = payload[2];
+    }
+    else if (ok && payload[0] == UBX_CLASS_NAV && payload[1] == UBX_NAV_TIMEUTC)
+    {
+      module.time_utc_rate = payload[2];
+    }
+  }
+  else if (id == UBX_CFG_RATE && len == 6)
+  {
+    uint16_t rate = payload[0] | (payload[1] << 8);
+    ok = rate >= 100;
+    if (ok)
+    {
+      module.meas_rate = rate;
+    }
+  }
+  else if (id == UBX_CFG_PRT && len == 20 && payload[0] == 1)
+  {
+    uint32_t baud = payload[8] | (payload[9] << 8) | ((uint32_t)payload[10] << 16) | ((uint32_t)payload[11] << 24);
+    ok = true;
+    module.pending_baud = baud;
+  }
+
+  uint8_t ack[2] = {cls, id};
+  module_send_ubx(UBX_CLASS_ACK, ok ? UBX_ACK_ACK : UBX_ACK_NAK, ack, sizeof(ack));
+}
+
+
+void module_send_ubx(uint8_t cls, uint8_t id, const uint8_t *payload, uint16_t len)
+{
+  uint8_t frame[_GPS_UBX_MAX_PAYLOAD + _GPS_UBX_FRAME_OVERHEAD];
+  size_t size = TinyGPSUbx::buildFrame(cls, id, payload, len, frame);
+  if (module.late)
+  {
+    module.late_out.append((const char *)frame, size);
+    module.late_at = now_ms + LATE_ACK_MS;
+    if (!quiet)
+    {
+      printf("  %6u ms  module answers late\n", (unsigned)now_ms);
+    }
+    return;
+  }
+  module.out.append((const char *)frame, size);
+}
+
+
+void module_send_nmea(const char *body)
+{
+  uint8_t checksum = 0;
+  for (const char *p = body; *p; ++p)
+  {
+    checksum ^= (uint8_t)*p;
+  }
+
+  char buffer[120];
+  snprintf(buffer, sizeof(buffer), "$%s*%02X\r\n", body, checksum);
+  module.out += buffer;
+}
+
+
+/**
+ * The output of one navigation solution
+ */
+void module_second(uint32_t second)
+{
+  char body[100];
+  unsigned hh = 12 + second / 3600;
+  unsigned mm = (second / 60) % 60;
+  unsigned ss = second % 60;
+
+  if (module.nmea_rate[UBX_NMEA_RMC])
+  {
+    snprintf(body, sizeof(body), "GPRMC,%02u%02u%02u.00,A,5925.85920,N,02444.99135,E,0.046,,161026,,,A", hh, mm, ss);
+    module_send_nmea(body);
+  }
+  if (module.nmea_rate[UBX_NMEA_VTG])
+  {
+    module_send_nmea("GPVTG,,T,,M,0.046,N,0.085,K,A");
+  }
+  if (module.nmea_rate[UBX_NMEA_GGA])
+  {
+    snprintf(body, sizeof(body), "GPGGA,%02u%02u%02u.00,5925.85920,N,02444.99135,E,1,08,1.01,45.3,M,18.5,M,,", hh, mm, ss);
+    module_send_nmea(body);
+  }
+  if (module.nmea_rate[UBX_NMEA_GSA])
+  {
+    module_send_nmea("GPGSA,A,3,05,13,15,18,20,23,24,29,,,,,1.86,1.01,1.56");
+  }
+  if (module.nmea_rate[UBX_NMEA_GSV])
+  {
+    module_send_nmea("GPGSV,3,1,11,05,43,198,33,13,55,262,40,15,68,094,45,18,21,060,28");
+    module_send_nmea("GPGSV,3,2,11,20,36,125,39,23,09,311,20,24,31,296,36,26,03,001,");
+    module_send_nmea("GPGSV,3,3,11,29,29,158,41,30,04,035,,46,13,217,");
+  }
+  if (module.nmea_rate[UBX_NMEA_GLL])
+  {
+    snprintf(body, sizeof(body), "GPGLL,5925.85920,N,02444.99135,E,%02u%02u%02u.00,A,A", hh, mm, ss);
+    module_send_nmea(body);
+  }
+  if (module.nmea_rate[UBX_NMEA_ZDA])
+  {
+    snprintf(body, sizeof(body), "GPZDA,%02u%02u%02u.00,16,10,2026,00,00", hh, mm, ss);
+    module_send_nmea(body);
+  }
+  if (module.time_utc_rate)
+  {
+    TinyGPSUbxNavTimeUtc utc = {};
+    utc.year = 2026;
+    utc.month = 10;
+    utc.day = 16;
+    utc.hour = hh;
+    utc.min = mm;
+    utc.sec = ss;
+    utc.valid = UBX_TIMEUTC_VALID_UTC;
+    module_send_ubx(UBX_CLASS_NAV, UBX_NAV_TIMEUTC, (const uint8_t *)&utc, sizeof(utc));
+  }
+}
+
+
+/**
+ * One millisecond on the serial line from the module to the host
+ */
+void module_tick(TinyGPSUbx &ubx)
+{
+  if (now_ms % module.meas_rate == 0)
+  {
+    module_second(now_ms / 1000);
+  }
+  if (!module.late_out.empty() && now_ms >= module.late_at)
+  {
+    module.out += module.late_out;
+    module.late_out.clear();
+  }
+
+  // 10 bits per byte
+  module.credit += module.baud / 10000.0;
+  size_t len = (size_t)module.credit;
+  if (len > module.out.size())
+  {
+    len = module.out.size();
+  }
+  if (module.out.empty())
+  {
+    module.credit = 0;
+  }
+  else
+  {
+    module.credit -= len;
+  }
+
+  if (len > 0)
+  {
+    module_bytes += len;
+    if (host_baud == module.baud)
+    {
+      ubx.encode(module.out.data(), len);
+    }
+    else
+    {
+      lost_bytes += len;
+    }
+    module.out.erase(0, len);
+  }
+
+  // The new baud rate applies once the acknowledgement is out
+  if (module.pending_baud != 0 && module.out.empty())
+  {
+    if (!quiet)
+    {
+      printf("  %6u ms  module baud %u\n", (unsigned)now_ms, (unsigned)module.pending_baud);
+    }
+    module.baud = module.pending_baud;
+    module.pending_baud = 0;
+  }
+}
+
+
+const char *message_name(uint8_t cls, uint8_t id)
+{
+  static char name[32];
+
+  if (cls == UBX_CLASS_CFG && id == UBX_CFG_MSG)
+    return "CFG-MSG";
+  if (cls == UBX_CLASS_CFG && id == UBX_CFG_RATE)
+    return "CFG-RATE";
+  if (cls == UBX_CLASS_CFG && id == UBX_CFG_PRT)
+    return "CFG-PRT";
+
+  snprintf(name, sizeof(name), "UBX %02X-%02X", cls, id);
+  return name;
+}
+
+
+/**
+ * Run the configuration against the module
+ * @return true if the outcome is the expected one
+ */
+bool run_scenario(const Scenario &s)
+{
+  TinyGPSPlus gps;
+  TinyGPSUbx ubx(gps);
+  TinyGPSCustom zda(gps, "GPZDA", 1);
+
+  printf("Scenario: %s\n", s.name);
+
+  module_reset(s);
+  host_baud = 9600;
+  now_ms = 0;
+  module_bytes = host_bytes = lost_bytes = 0;
+
+  // Factory defaults
+  for (; now_ms < MEASURE_MS; ++now_ms)
+  {
+    module_tick(ubx);
+  }
+  uint32_t before_bytes = module_bytes;
+  uint32_t before_sentences = gps.passedChecksum();
+
+  // Configuration
+  uint8_t state = GPS_CONFIG_BUSY;
+  gps_config_begin(ubx, host_write, host_set_baud, host_baud, now_ms);
+  uint32_t config_start = now_ms;
+
+  for (; state == GPS_CONFIG_BUSY && now_ms < SCENARIO_TIMEOUT_MS; ++now_ms)
+  {
+    module_tick(ubx);
+    if (now_ms % POLL_TIME_MS == 0)
+    {
+      state = gps_config_update(now_ms);
+    }
+  }
+  uint32_t config_time = now_ms - config_start;
+
+  // Let the baud change settle, then measure again
+  uint32_t settle_end = now_ms + 1000;
+  for (; now_ms < settle_end; ++now_ms)
+  {
+    module_tick(ubx);
+  }
+  uint32_t after_start_bytes = module_bytes;
+  uint32_t after_start_sentences = gps.passedChecksum();
+  uint32_t after_end = now_ms + MEASURE_MS;
+  for (; now_ms < after_end; ++now_ms)
+  {
+    module_tick(ubx);
+  }
+
+  double before_bps = before_bytes * 1000.0 / MEASURE_MS;
+  double after_bps = (module_bytes - after_start_bytes) * 1000.0 / MEASURE_MS;
+  printf("  before: %7.1f bytes/s, %4.1f%% of %u baud, %u sentences/s\n", before_bps,
+         before_bps * 10 * 100 / s.module_baud, (unsigned)s.module_baud,
+         (unsigned)(before_sentences * 1000 / MEASURE_MS));
+  printf("  after:  %7.1f bytes/s, %4.1f%% of %u baud, %u sentences/s\n", after_bps,
+         after_bps * 10 * 100 / module.baud, (unsigned)module.baud,
+         (unsigned)((gps.passedChecksum() - after_start_sentences) * 1000 / MEASURE_MS));
+  printf("  state %u after %u ms, acked %u, nakked %u, baud %u, UBX frames %u, lost bytes %u\n",
+         (unsigned)state, (unsigned)config_time, (unsigned)gps_config_acked(),
+         (unsigned)gps_config_nakked(), (unsigned)gps_config_baud(),
+         (unsigned)ubx.framesProcessed(), (unsigned)lost_bytes);
+
+  bool ok = state == s.state
+    && gps_config_acked() == s.acked
+    && gps_config_nakked() == s.nakked
+    && gps_config_baud() == s.baud
+    && host_baud == module.baud
+    && gps.time.isValid() && gps.time.age() < 1500
+    && gps.date.isValid() && gps.date.age() < 1500;
+
+  // A configured module must have switched ZDA on, and every command
+  // counted as acknowledged must have reached it
+  if (state == GPS_CONFIG_DONE)
+  {
+    bool utc_rejected = s.nak_class == UBX_CLASS_NAV && s.nak_id == UBX_NAV_TIMEUTC;
+    ok = ok && zda.isValid() && after_bps < before_bps
+      && module.nmea_rate[UBX_NMEA_GSV] == 0 && module.nmea_rate[UBX_NMEA_GLL] == 0
+      && module.nmea_rate[UBX_NMEA_VTG] == 0 && module.nmea_rate[UBX_NMEA_GSA] == 0
+      && module.nmea_rate[UBX_NMEA_RMC] == 0 && (module.time_utc_rate != 0) != utc_rejected;
+  }
+
+  printf("  %s\n\n", ok ? "OK" : "UNEXPECTED");
+  return ok;
+}
+
+
+int main(int argc, char *argv[])
+{
+  if (argc > 1 && strcmp(argv[1], "-q") == 0)
+  {
+    quiet = true;
+  }
+
+  static const Scenario scenarios[] = {
+    // name                       baud   ubx   NAK target               drop late  outcome            acked nak baud
+    {"factory defaults",          9600, true,  0, 0,                    0, 0, GPS_CONFIG_DONE,   8, 0, GPS_CONFIG_BAUD},
+    {"already configured",   GPS_CONFIG_BAUD, true,  0, 0,              0, 0, GPS_CONFIG_DONE,   8, 0, GPS_CONFIG_BAUD},
+    {"NAV-TIMEUTC rejected",      9600, true,  UBX_CLASS_NAV, UBX_NAV_TIMEUTC, 0, 0, GPS_CONFIG_DONE, 7, 1, GPS_CONFIG_BAUD},
+    {"lost commands",             9600, true,  0, 0,                    0x3, 0, GPS_CONFIG_DONE, 8, 0, GPS_CONFIG_BAUD},
+    // The late answer to the first try must not pass for the answer to
+    // the next CFG-MSG, which is lost
+    {"late ACK",                  9600, true,  0, 0,                    0x4, 0x1, GPS_CONFIG_DONE, 8, 0, GPS_CONFIG_BAUD},
+    {"NMEA-only module",          9600, false, 0, 0,                    0, 0, GPS_CONFIG_FAILED, 0, 0, 9600},
+  };
+
+  int failed = 0;
+  for (size_t i = 0; i < sizeof(scenarios) / sizeof(scenarios[0]); ++i)
+  {
+    if (!run_scenario(scenarios[i]))
+    {
+      ++failed;
+    }
+  }
+
+  printf("%d of %d scenarios as expected\n",
+         (int)(sizeof(scenarios) / sizeof(scenarios[0])) - failed,
+         (int)(sizeof(scenarios) / sizeof(scenarios[0])));
+  return failed == 0 ? 0 : 1;
+}